@@ -2,22 +2,47 @@
 
 namespace nall::Beat::Single {
 
-inline auto apply(array_view<u8> source, array_view<u8> beat, maybe<string&> manifest = {}, maybe<string&> result = {}) -> maybe<vector<u8>> {
+//returns the target size recorded in the patch header, so that the target can be allocated (or mapped) ahead of apply()
+inline auto targetSize(array_view<u8> beat) -> maybe<u64> {
+  if(beat.size() < 19) return nothing;
+  if(beat[0] != 'B' || beat[1] != 'P' || beat[2] != 'S' || beat[3] != '1') return nothing;
+
+  u64 beatOffset = 4;
+  auto decode = [&]() -> u64 {
+    u64 data = 0, shift = 1;
+    while(beatOffset < beat.size()) {
+      u8 x = beat[beatOffset++];
+      data += (x & 0x7f) * shift;
+      if(x & 0x80) break;
+      shift <<= 7;
+      data += shift;
+    }
+    return data;
+  };
+
+  decode();  //source size
+  return decode();
+}
+
+//applies the patch into the buffer returned by reserve(size), which must hold at least size bytes, or be nullptr when it cannot
+//the buffer is only requested to grow as commands are carried out: the target size in the header is never trusted
+//commands are carried out with bulk copies rather than byte by byte; returns the number of bytes written
+template<typename Reserve>
+inline auto applyWith(array_view<u8> source, array_view<u8> beat, const Reserve& reserve, maybe<string&> manifest, maybe<string&> result) -> maybe<u64> {
+  u64 outputOffset = 0;
   #define error(text) { if(result) *result = {"error: ", text}; return {}; }
-  #define warning(text) { if(result) *result = {"warning: ", text}; return target; }
-  #define success() { if(result) *result = ""; return target; }
+  #define warning(text) { if(result) *result = {"warning: ", text}; return outputOffset; }
+  #define success() { if(result) *result = ""; return outputOffset; }
   if(beat.size() < 19) error("beat size mismatch");
 
-  vector<u8> target;
-
-  u32 beatOffset = 0;
+  u64 beatOffset = 0;
   auto read = [&]() -> u8 {
     return beat[beatOffset++];
   };
 
   auto decode = [&]() -> u64 {
     u64 data = 0, shift = 1;
-    while(true) {
+    while(beatOffset < beat.size()) {
       u8 x = read();
       data += (x & 0x7f) * shift;
       if(x & 0x80) break;
@@ -27,56 +52,79 @@ inline auto apply(array_view<u8> source, array_view<u8> beat, maybe<string&> man
     return data;
   };
 
-  auto write = [&](u8 data) {
-    target.append(data);
-  };
-
   if(read() != 'B') error("beat header invalid");
   if(read() != 'P') error("beat header invalid");
   if(read() != 'S') error("beat header invalid");
   if(read() != '1') error("beat version mismatch");
   if(decode() != source.size()) error("source size mismatch");
-  u32 targetSize = decode();
-  target.reserve(targetSize);
-  u32 metadataSize = decode();
-  for(u32 n : range(metadataSize)) {
-    auto data = read();
-    if(manifest) manifest->append((char)data);
-  }
+  u64 targetSize = decode();
+  u64 metadataSize = decode();
+  if(metadataSize > beat.size() - 12 - min(beat.size() - 12, beatOffset)) error("beat data invalid");
+  if(manifest) manifest->append(string_view{(const char*)beat.data() + beatOffset, (u32)metadataSize});
+  beatOffset += metadataSize;
 
   enum : u32 { SourceRead, TargetRead, SourceCopy, TargetCopy };
 
-  u32 sourceRelativeOffset = 0, targetRelativeOffset = 0;
-  while(beatOffset < beat.size() - 12) {
-    u32 length = decode();
+  u8* output = nullptr;
+  const u64 commandsEnd = beat.size() - 12;
+  u64 sourceRelativeOffset = 0, targetRelativeOffset = 0;
+  while(beatOffset < commandsEnd) {
+    u64 length = decode();
     u32 mode = length & 3;
     length = (length >> 2) + 1;
+    if(length > ~0ull - outputOffset) error("beat data invalid");
 
+    u64 from = 0;
     if(mode == SourceRead) {
-      while(length--) write(source[target.size()]);
+      from = outputOffset;
+      if(outputOffset + length > source.size()) error("beat data invalid");
     } else if(mode == TargetRead) {
-      while(length--) write(read());
+      from = beatOffset;
+      if(length > commandsEnd - min(commandsEnd, beatOffset)) error("beat data invalid");
+      beatOffset += length;
     } else {
-      s32 offset = decode();
-      offset = offset & 1 ? -(offset >> 1) : (offset >> 1);
+      u64 offset = decode();
+      s64 relative = offset & 1 ? -(s64)(offset >> 1) : (s64)(offset >> 1);
       if(mode == SourceCopy) {
-        sourceRelativeOffset += offset;
-        while(length--) write(source[sourceRelativeOffset++]);
+        from = sourceRelativeOffset += relative;
+        if(from > source.size() || length > source.size() - from) error("beat data invalid");
+        sourceRelativeOffset += length;
       } else {
-        targetRelativeOffset += offset;
-        while(length--) write(target[targetRelativeOffset++]);
+        from = targetRelativeOffset += relative;
+        if(from >= outputOffset) error("beat data invalid");
+        targetRelativeOffset += length;
+      }
+    }
+
+    //the buffer only grows once the command is known to be valid, so that a short patch cannot force a large allocation
+    if(!(output = reserve(outputOffset + length))) error("beat data invalid");
+
+    if(mode == SourceRead || mode == SourceCopy) {
+      memcpy(output + outputOffset, source.data() + from, length);
+    } else if(mode == TargetRead) {
+      memcpy(output + outputOffset, beat.data() + from, length);
+    } else {
+      //the copy may overlap what it is writing, repeating the last (outputOffset - offset) bytes:
+      //copy from the start of the pattern each time, so that the copied span doubles with every step
+      u64 to = outputOffset, remaining = length;
+      while(remaining) {
+        u64 chunk = min(remaining, to - from);
+        memcpy(output + to, output + from, chunk);
+        to += chunk, remaining -= chunk;
       }
     }
+    outputOffset += length;
   }
 
   u32 sourceHash = 0, targetHash = 0, beatHash = 0;
+  beatOffset = commandsEnd;
   for(u32 shift : range(0, 32, 8)) sourceHash |= read() << shift;
   for(u32 shift : range(0, 32, 8)) targetHash |= read() << shift;
   for(u32 shift : range(0, 32, 8)) beatHash   |= read() << shift;
 
-  if(target.size() != targetSize) warning("target size mismatch");
+  if(outputOffset != targetSize) warning("target size mismatch");
   if(sourceHash != Hash::CRC32(source).value()) warning("source hash mismatch");
-  if(targetHash != Hash::CRC32(target).value()) warning("target hash mismatch");
+  if(targetHash != Hash::CRC32({outputOffset ? output : nullptr, outputOffset}).value()) warning("target hash mismatch");
   if(beatHash != Hash::CRC32({beat.data(), beat.size() - 4}).value()) warning("beat hash mismatch");
 
   success();
@@ -85,4 +133,28 @@ inline auto apply(array_view<u8> source, array_view<u8> beat, maybe<string&> man
   #undef success
 }
 
+//applies the patch directly into target, which must hold at least targetSize(beat) bytes
+inline auto applyTo(array_view<u8> source, array_view<u8> beat, array_span<u8> target, maybe<string&> manifest = {}, maybe<string&> result = {}) -> maybe<u64> {
+  if(auto size = targetSize(beat); size && target.size() < *size) {
+    if(result) *result = "error: target size mismatch";
+    return {};
+  }
+  return applyWith(source, beat, [&](u64 size) -> u8* {
+    return size <= target.size() ? target.data() : nullptr;
+  }, manifest, result);
+}
+
+inline auto apply(array_view<u8> source, array_view<u8> beat, maybe<string&> manifest = {}, maybe<string&> result = {}) -> maybe<vector<u8>> {
+  //most targets are close to the size of their source: only that much is allocated up front
+  vector<u8> target;
+  if(auto size = targetSize(beat)) target.reserve(min(*size, source.size() + beat.size()));
+  auto written = applyWith(source, beat, [&](u64 size) -> u8* {
+    if(size > target.size()) target.reallocate(size);  //capacity grows in powers of two
+    return target.data();
+  }, manifest, result);
+  if(!written) return {};
+  target.resize(*written);
+  return target;
+}
+
 }
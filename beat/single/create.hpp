@@ -1,10 +1,17 @@
 #pragma once
 
+#include <nall/hash-chain.hpp>
+#include <nall/parallel.hpp>
 #include <nall/suffix-array.hpp>
 
 namespace nall::Beat::Single {
 
-inline auto create(array_view<u8> source, array_view<u8> target, string_view manifest = {}) -> vector<u8> {
+//a target no larger than one block is matched as a whole, against suffix arrays of the entire source and target.
+//larger targets are split into blocks that are matched in parallel: source matches are found anywhere in the source through
+//hash chains indexed once and shared by every block, and target matches within the block and the quarter block before it.
+//each block's commands are encoded as soon as every earlier block has been, and no block starts more than two blocks per
+//thread ahead of that, so only a bounded number of blocks is ever held in memory at once.
+inline auto create(array_view<u8> source, array_view<u8> target, string_view manifest = {}, u64 blockSize = 16_MiB, u32 threads = 0) -> vector<u8> {
   vector<u8> beat;
 
   auto write = [&](u8 data) {
@@ -25,65 +32,134 @@ inline auto create(array_view<u8> source, array_view<u8> target, string_view man
   encode(source.size()), encode(target.size()), encode(manifest.size());
   for(auto& byte : manifest) write(byte);
 
-  //generating lrcp() arrays for source requires O(4n) computations, and O(16m) memory,
-  //but it reduces find() complexity from O(n log m) to O(n + log m). and yet in practice,
-  //no matter how large n scales to, the O(n + log m) find() is paradoxically slower.
-  auto sourceArray = SuffixArray(source);
-  auto targetArray = SuffixArray(target).lpf();
-
   enum : u32 { SourceRead, TargetRead, SourceCopy, TargetCopy };
-  u32 outputOffset = 0, sourceRelativeOffset = 0, targetRelativeOffset = 0;
+  struct Command {
+    u32 mode;
+    u64 length;
+    u64 offset;  //absolute offset into the source (SourceCopy) or target (TargetRead, TargetCopy)
+  };
 
-  u32 targetReadLength = 0;
+  //commands are encoded in order, since offsets are stored relative to the previous command of the same kind
+  u64 sourceRelativeOffset = 0, targetRelativeOffset = 0;
+  auto relative = [&](u64& previous, u64 offset, u64 length) {
+    s64 relativeOffset = offset - previous;
+    previous = offset + length;
+    encode((relativeOffset < 0) | (u64)(relativeOffset < 0 ? -relativeOffset : relativeOffset) << 1);
+  };
+
+  u64 targetReadOffset = 0, targetReadLength = 0;
   auto flush = [&] {
     if(!targetReadLength) return;
     encode(TargetRead | ((targetReadLength - 1) << 2));
-    u32 offset = outputOffset - targetReadLength;
-    while(targetReadLength) write(target[offset++]), targetReadLength--;
+    for(u64 offset : range(targetReadOffset, targetReadOffset + targetReadLength)) write(target[offset]);
+    targetReadLength = 0;
   };
 
-  u32 overlap = min(source.size(), target.size());
-  while(outputOffset < target.size()) {
-    u32 mode = TargetRead, longestLength = 3, longestOffset = 0;
-    s32 length = 0, offset = outputOffset;
-
-    while(offset < overlap) {
-      if(source[offset] != target[offset]) break;
-      length++, offset++;
-    }
-    if(length > longestLength) {
-      mode = SourceRead, longestLength = length;
+  auto emit = [&](const Command& command) {
+    if(command.mode == TargetRead) {
+      //runs on either side of a block boundary are joined
+      if(!targetReadLength) targetReadOffset = command.offset;
+      targetReadLength += command.length;
+      return;
     }
+    flush();
+    encode(command.mode | ((command.length - 1) << 2));
+    if(command.mode == SourceCopy) relative(sourceRelativeOffset, command.offset, command.length);
+    if(command.mode == TargetCopy) relative(targetRelativeOffset, command.offset, command.length);
+  };
 
-    sourceArray.find(length, offset, {target.data() + outputOffset, target.size() - outputOffset});
-    if(length > longestLength) {
-      mode = SourceCopy, longestLength = length, longestOffset = offset;
-    }
+  blockSize = max<u64>(blockSize, 1);
+  u32 blocks = max<u64>(1, (target.size() + blockSize - 1) / blockSize);
+  if(!threads) threads = parallel::concurrency();
+  bool whole = blocks == 1;
 
-    targetArray.previous(length, offset, outputOffset);
-    if(length > longestLength) {
-      mode = TargetCopy, longestLength = length, longestOffset = offset;
+  //generating lrcp() arrays for source requires O(4n) computations, and O(16m) memory,
+  //but it reduces find() complexity from O(n log m) to O(n + log m). and yet in practice,
+  //no matter how large n scales to, the O(n + log m) find() is paradoxically slower.
+  auto sourceArray = SuffixArray(whole ? source : array_view<u8>{});
+  auto sourceChain = HashChain(whole ? array_view<u8>{} : source);
+  if(!whole) sourceChain.index();
+
+  //block k is stored in slot k % window until it is encoded
+  u32 window = whole ? 1 : 2 * threads;
+  vector<vector<Command>> pending;
+  for(u32 slot : range(window)) pending.append(vector<Command>{});
+  vector<u8> ready;
+  ready.resize(window);
+  u32 encoded = 0;
+  std::mutex lock;
+  std::condition_variable advanced;
+
+  parallel::run(blocks, [&](u32 block) {
+    //blocks are handed out in order, so the block being waited on is never itself waiting here
+    { std::unique_lock<std::mutex> guard{lock};
+      advanced.wait(guard, [&] { return block < encoded + window; });
     }
 
-    if(mode == TargetRead) {
-      targetReadLength++;  //queue writes to group sequential commands
-      outputOffset++;
-    } else {
-      flush();
-      encode(mode | ((longestLength - 1) << 2));
-      if(mode == SourceCopy) {
-        s32 relativeOffset = longestOffset - sourceRelativeOffset;
-        sourceRelativeOffset = longestOffset + longestLength;
-        encode(relativeOffset < 0 | abs(relativeOffset) << 1);
+    u64 targetStart = block * blockSize;
+    u64 targetEnd = min<u64>(target.size(), targetStart + blockSize);
+    u64 historyStart = targetStart - min(targetStart, blockSize / 4);
+    auto targetArray = SuffixArray({target.data() + historyStart, targetEnd - historyStart}).lpf();
+
+    auto& output = pending[block % window];
+    u64 outputOffset = targetStart, targetReadLength = 0;
+    auto flush = [&] {
+      if(!targetReadLength) return;
+      output.append({TargetRead, targetReadLength, outputOffset - targetReadLength});
+      targetReadLength = 0;
+    };
+
+    u64 overlap = min<u64>(source.size(), targetEnd);
+    while(outputOffset < targetEnd) {
+      u32 mode = TargetRead;
+      u64 longestLength = 3, longestOffset = 0;
+      u64 length = 0, offset = outputOffset;
+
+      while(offset < overlap) {
+        if(source[offset] != target[offset]) break;
+        length++, offset++;
+      }
+      if(length > longestLength) {
+        mode = SourceRead, longestLength = length;
+      }
+
+      s32 matchLength = 0, matchOffset = 0;
+      if(source) {
+        array_view<u8> match{target.data() + outputOffset, targetEnd - outputOffset};
+        if(whole) sourceArray.find(matchLength, matchOffset, match);
+        else sourceChain.find(matchLength, matchOffset, match);
+        if(matchLength > 0 && (u64)matchLength > longestLength) {
+          mode = SourceCopy, longestLength = matchLength, longestOffset = matchOffset;
+        }
       }
-      if(mode == TargetCopy) {
-        s32 relativeOffset = longestOffset - targetRelativeOffset;
-        targetRelativeOffset = longestOffset + longestLength;
-        encode(relativeOffset < 0 | abs(relativeOffset) << 1);
+
+      targetArray.previous(matchLength, matchOffset, outputOffset - historyStart);
+      if(matchLength > 0 && (u64)matchLength > longestLength) {
+        mode = TargetCopy, longestLength = matchLength, longestOffset = historyStart + matchOffset;
       }
-      outputOffset += longestLength;
+
+      if(mode == TargetRead) {
+        targetReadLength++;  //queue writes to group sequential commands
+        outputOffset++;
+      } else {
+        flush();
+        output.append({mode, longestLength, longestOffset});
+        outputOffset += longestLength;
+      }
+    }
+    flush();
+
+    lock_guard<std::mutex> guard{lock};
+    ready[block % window] = true;
+    while(encoded < blocks && ready[encoded % window]) {
+      u32 slot = encoded % window;
+      for(auto& command : pending[slot]) emit(command);
+      pending[slot].reset();
+      ready[slot] = false;
+      encoded++;
     }
-  }
+    advanced.notify_all();
+  }, threads);
   flush();
 
   auto sourceHash = Hash::CRC32(source);
@@ -29,3 +29,4 @@
 #include <nall/cd/rspc.hpp>
 #include <nall/cd/scrambler.hpp>
 #include <nall/cd/session.hpp>
+#include <nall/cd/sector.hpp>
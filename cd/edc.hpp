@@ -5,27 +5,52 @@
 namespace nall::CD::EDC {
 
 //polynomial(x) = (x^16 + x^15 + x^2 + 1) * (x^16 + x^2 + x + 1)
-inline auto polynomial(u8 x) -> u32 {
-  static u32 lookup[256]{};
-  static bool once = false;
-  if(!once) { once = true;
-    for(u32 n : range(256)) {
-      u32 edc = n;
-      for(u32 b : range(8)) edc = edc >> 1 ^ (edc & 1 ? 0xd8018001 : 0);
-      lookup[n] = edc;
+//table[0] is the classic byte-at-a-time table; table[n] advances a byte through n further zero bytes
+inline auto tables() -> const u32 (&)[8][256] {
+  struct Tables {
+    Tables() {
+      for(u32 n : range(256)) {
+        u32 edc = n;
+        for(u32 b : range(8)) edc = edc >> 1 ^ (edc & 1 ? 0xd8018001 : 0);
+        table[0][n] = edc;
+      }
+      for(u32 n : range(256)) {
+        for(u32 slice : range(1, 8)) {
+          table[slice][n] = table[slice - 1][n] >> 8 ^ table[0][(u8)table[slice - 1][n]];
+        }
+      }
     }
-  }
-  return lookup[x];
+    u32 table[8][256];
+  };
+  static const Tables instance;
+  return instance.table;
+}
+
+inline auto polynomial(u8 x) -> u32 {
+  return tables()[0][x];
 }
 
 //
 
-inline auto create(array_view<u8> input) -> u32 {
-  u32 sum = 0;
-  for(auto& byte : input) sum = sum >> 8 ^ polynomial(sum ^ byte);
+//continues sum over input: slice-by-8 consumes eight bytes per step through eight lookup tables
+inline auto update(u32 sum, const u8* p, u64 size) -> u32 {
+  auto& table = tables();
+  for(; size >= 8; size -= 8, p += 8) {
+    u32 one = sum ^ (p[0] << 0 | p[1] << 8 | p[2] << 16 | (u32)p[3] << 24);
+    u32 two = p[4] << 0 | p[5] << 8 | p[6] << 16 | (u32)p[7] << 24;
+    sum = table[7][(u8)(one >>  0)] ^ table[6][(u8)(one >>  8)]
+        ^ table[5][(u8)(one >> 16)] ^ table[4][(u8)(one >> 24)]
+        ^ table[3][(u8)(two >>  0)] ^ table[2][(u8)(two >>  8)]
+        ^ table[1][(u8)(two >> 16)] ^ table[0][(u8)(two >> 24)];
+  }
+  while(size--) sum = sum >> 8 ^ table[0][(u8)(sum ^ *p++)];
   return sum;
 }
 
+inline auto create(array_view<u8> input) -> u32 {
+  return update(0, input.data(), input.size());
+}
+
 inline auto create(array_view<u8> input, array_span<u8> output) -> bool {
   if(output.size() != 4) return false;
   auto sum = create(input);
@@ -4,37 +4,86 @@
 
 namespace nall::CD::RSPC {
 
-inline auto encodeP(array_view<u8> input, array_span<u8> parity) -> bool {
-  ReedSolomon<26,24> s;
-  u32 lo = 0, hi = 43 * 2;
-  for(u32 x : range(43)) {
-    for(u32 w : range(2)) {  //16-bit words
-      u32 z = 0;
-      for(u32 y : range(24)) {
-        s[z++] = input[(y * 43 + x) * 2 + w];
+//P and Q parity are linear in their inputs: each parity byte is a sum of the input bytes scaled by fixed coefficients.
+//the coefficients are derived from ReedSolomon once; every column is then encoded at once, a row of inputs at a time.
+//scaling by a coefficient is done with two sixteen-entry tables, one for each nibble of the input byte:
+//with SSSE3 these are looked up sixteen bytes at a time (PSHUFB), otherwise a byte at a time.
+template<u32 Length, u32 Inputs>
+struct Kernel {
+  static auto instance() -> const Kernel& {
+    static const Kernel kernel;
+    return kernel;
+  }
+
+  //parity0[c] and parity1[c] receive the two parity bytes of column c, whose inputs are rows[m * stride + c]
+  auto encode(const u8* rows, u32 stride, u32 columns, u8* parity0, u8* parity1) const -> void {
+    u32 c = 0;
+    #if defined(__SSSE3__)
+    const __m128i mask = _mm_set1_epi8(0x0f);
+    for(; c + 16 <= columns; c += 16) {
+      __m128i p0 = _mm_setzero_si128();
+      __m128i p1 = _mm_setzero_si128();
+      for(u32 m : range(Inputs)) {
+        __m128i x = _mm_loadu_si128((const __m128i*)(rows + m * stride + c));
+        __m128i lo = _mm_and_si128(x, mask);
+        __m128i hi = _mm_and_si128(_mm_srli_epi16(x, 4), mask);
+        p0 = _mm_xor_si128(p0, _mm_shuffle_epi8(_mm_load_si128((const __m128i*)tables[0][m][0]), lo));
+        p0 = _mm_xor_si128(p0, _mm_shuffle_epi8(_mm_load_si128((const __m128i*)tables[0][m][1]), hi));
+        p1 = _mm_xor_si128(p1, _mm_shuffle_epi8(_mm_load_si128((const __m128i*)tables[1][m][0]), lo));
+        p1 = _mm_xor_si128(p1, _mm_shuffle_epi8(_mm_load_si128((const __m128i*)tables[1][m][1]), hi));
       }
+      _mm_storeu_si128((__m128i*)(parity0 + c), p0);
+      _mm_storeu_si128((__m128i*)(parity1 + c), p1);
+    }
+    #endif
+    for(; c < columns; c++) {
+      u8 p0 = 0, p1 = 0;
+      for(u32 m : range(Inputs)) {
+        u8 x = rows[m * stride + c];
+        p0 ^= tables[0][m][0][x & 15] ^ tables[0][m][1][x >> 4];
+        p1 ^= tables[1][m][0][x & 15] ^ tables[1][m][1][x >> 4];
+      }
+      parity0[c] = p0;
+      parity1[c] = p1;
+    }
+  }
+
+private:
+  Kernel() {
+    ReedSolomon<Length, Inputs> s;
+    for(u32 m : range(Inputs)) {
+      for(u32 n : range(Inputs)) s[n] = n == m;
       s.generateParity();
-      parity[lo++] = s[z++];
-      parity[hi++] = s[z++];
+      for(u32 p : range(2)) {
+        auto coefficient = s[Inputs + p];
+        for(u32 x : range(16)) {
+          tables[p][m][0][x] = coefficient * (u8)x;
+          tables[p][m][1][x] = coefficient * (u8)(x << 4);
+        }
+      }
     }
   }
+
+  alignas(16) u8 tables[2][Inputs][2][16];  //[parity][input][low, high nibble][nibble]
+};
+
+inline auto encodeP(array_view<u8> input, array_span<u8> parity) -> bool {
+  //each of the 24 rows holds one input of all 43 * 2 columns
+  Kernel<26,24>::instance().encode(input.data(), 43 * 2, 43 * 2, parity.data(), parity.data() + 43 * 2);
   return true;
 }
 
 inline auto encodeQ(array_view<u8> input, array_span<u8> parity) -> bool {
-  ReedSolomon<45,43> s;
-  u32 lo = 0, hi = 26 * 2;
-  for(u32 y : range(26)) {
-    for(u32 w : range(2)) {
-      u32 z = 0;
-      for(u32 x : range(43)) {
-        s[z++] = input[((x * 44 + y * 43) * 2 + w) % (26 * 43 * 2)];
-      }
-      s.generateParity();
-      parity[lo++] = s[z++];
-      parity[hi++] = s[z++];
+  //the 26 * 2 diagonals are gathered into rows first
+  u8 rows[43][26 * 2];
+  for(u32 x : range(43)) {
+    for(u32 y = 0, word = x * 44; y < 26; y++, word += 43) {
+      if(word >= 26 * 43) word -= 26 * 43;
+      rows[x][y * 2 + 0] = input[word * 2 + 0];
+      rows[x][y * 2 + 1] = input[word * 2 + 1];
     }
   }
+  Kernel<45,43>::instance().encode(rows[0], 26 * 2, 26 * 2, parity.data(), parity.data() + 26 * 2);
   return true;
 }
 
@@ -45,6 +94,31 @@ inline auto encodeMode1(array_span<u8> sector) -> bool {
   return true;
 }
 
+//encodes each of a run of consecutive 2352-byte sectors
+inline auto encodeMode1(array_span<u8> sectors, u32 count) -> bool {
+  if(sectors.size() != 2352ull * count) return false;
+  for(u32 n : range(count)) encodeMode1({sectors.data() + 2352ull * n, 2352});
+  return true;
+}
+
+//returns true if the P and Q parity of the sector are intact
+inline auto verifyMode1(array_view<u8> sector) -> bool {
+  if(sector.size() != 2352) return false;
+  u8 parity[172 + 104];
+  encodeP({sector.data() + 12, 2064}, {parity, 172});
+  encodeQ({sector.data() + 12, 2236}, {parity + 172, 104});
+  return memcmp(parity, sector.data() + 2076, 172 + 104) == 0;
+}
+
+//returns the number of leading sectors in a run whose parity is intact (count if all are)
+inline auto verifyMode1(array_view<u8> sectors, u32 count) -> u32 {
+  if(sectors.size() != 2352ull * count) return 0;
+  for(u32 n : range(count)) {
+    if(!verifyMode1({sectors.data() + 2352ull * n, 2352})) return n;
+  }
+  return count;
+}
+
 //
 
 inline auto decodeP(array_span<u8> input, array_span<u8> parity) -> s32 {
@@ -113,6 +187,7 @@ inline auto decodeQ(array_span<u8> input, array_span<u8> parity) -> s32 {
 
 inline auto decodeMode1(array_span<u8> sector) -> bool {
   if(sector.size() != 2352) return false;
+  if(verifyMode1(sector)) return true;  //far cheaper than computing syndromes when there are no errors
   //P corrections can allow Q corrections that previously failed to succeed, and vice versa.
   //the more iterations, the more chances to correct errors, but the more computationally expensive it is.
   //there must be a limit on the amount of retries, or this function may get stuck in an infinite loop.
@@ -3,31 +3,47 @@
 namespace nall::CD::Scrambler {
 
 //polynomial(x) = x^15 + x + 1
-inline auto polynomial(u32 x) -> u8 {
-  static u8 lookup[2340]{};
-  static bool once = false;
-  if(!once) { once = true;
-    u16 shift = 0x0001;
-    for(u32 n : range(2340)) {
-      lookup[n] = shift;
-      for(u32 b : range(8)) {
-        bool carry = shift & 1 ^ shift >> 1 & 1;
-        shift = (carry << 15 | shift) >> 1;
+//the scrambler is reset at the start of every sector, so its output is the same 2340-byte keystream each time
+inline auto keystream() -> const u8 (&)[2340] {
+  struct Keystream {
+    Keystream() {
+      u16 shift = 0x0001;
+      for(u32 n : range(2340)) {
+        lookup[n] = shift;
+        for(u32 b : range(8)) {
+          bool carry = shift & 1 ^ shift >> 1 & 1;
+          shift = (carry << 15 | shift) >> 1;
+        }
       }
     }
-  }
-  return lookup[x];
+    u8 lookup[2340];
+  };
+  static const Keystream instance;
+  return instance.lookup;
+}
+
+inline auto polynomial(u32 x) -> u8 {
+  return keystream()[x];
 }
 
 //
 
+//the keystream is applied eight bytes at a time
 inline auto transform(array_span<u8> sector) -> bool {
   if(sector.size() == 2352) sector += 12;  //header is not scrambled
   if(sector.size() != 2340) return false;  //F1 frames only
 
-  for(u32 index : range(2340)) {
-    sector[index] ^= polynomial(index);
+  u8* data = sector.data();
+  const u8* key = keystream();
+  u32 index = 0;
+  for(; index + 8 <= 2340; index += 8) {
+    u64 x, y;
+    memcpy(&x, data + index, 8);
+    memcpy(&y, key + index, 8);
+    x ^= y;
+    memcpy(data + index, &x, 8);
   }
+  for(; index < 2340; index++) data[index] ^= key[index];
 
   return true;
 }
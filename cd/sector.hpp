@@ -0,0 +1,47 @@
+#pragma once
+
+//sector synthesis: sync, header, user data, error detection and correction codes,
+//and optionally scrambling and subchannel data, all generated by a single call per sector
+
+namespace nall::CD::Sector {
+
+//builds a sector in target (2352 bytes, or 2448 bytes with subchannel data following) around its user data:
+//mode 0: no user data; mode 1: 2048 bytes, followed by EDC and P/Q parity; mode 2 (formless): 2336 bytes
+//shorter payloads are zero-filled, and the payload may already be in place at target + 16
+//scramble produces the sector as it is recorded on disc, rather than as it is stored in disc images
+inline auto build(u8 mode, s32 lba, array_view<u8> payload, array_span<u8> target, array_view<u8> subchannel = {}, bool scramble = false) -> bool {
+  if(mode > 2) return false;
+  if(target.size() != 2352 && target.size() != 2448) return false;
+  u32 capacity = mode == 1 ? 2048 : 2336;
+  if(payload.size() > (mode ? capacity : 0)) return false;
+
+  u8* sector = target.data();
+  Sync::create({sector, 12});
+  auto [minute, second, frame] = MSF(lba);
+  sector[12] = BCD::encode(minute);
+  sector[13] = BCD::encode(second);
+  sector[14] = BCD::encode(frame);
+  sector[15] = mode;
+  if(payload.size() && payload.data() != sector + 16) memmove(sector + 16, payload.data(), payload.size());
+  memset(sector + 16 + payload.size(), 0x00, capacity - payload.size());
+
+  if(mode == 1) {
+    u32 edc = EDC::update(0, sector, 2064);
+    sector[2064] = edc >>  0;
+    sector[2065] = edc >>  8;
+    sector[2066] = edc >> 16;
+    sector[2067] = edc >> 24;
+    memset(sector + 2068, 0x00, 8);  //reserved
+    RSPC::encodeMode1({sector, 2352});
+  }
+
+  if(scramble) Scrambler::transform({sector, 2352});
+
+  if(target.size() == 2448) {
+    if(subchannel.size() == 96) memcpy(sector + 2352, subchannel.data(), 96);
+    else memset(sector + 2352, 0x00, 96);
+  }
+  return true;
+}
+
+}
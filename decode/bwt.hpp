@@ -2,10 +2,11 @@
 
 //burrows-wheeler transform
 
-#include <nall/suffix-array.hpp>
-
 namespace nall::Decode {
 
+//the sorted first column is never built: row i of the last column maps to row
+//first[L[i]] + (occurrences of L[i] in L[0..i)) of the first column (LF-mapping), found with counting alone
+
 inline auto BWT(array_view<u8> input) -> vector<u8> {
   vector<u8> output;
 
@@ -15,32 +16,26 @@ inline auto BWT(array_view<u8> input) -> vector<u8> {
 
   u32 I = 0;
   for(u32 byte : range(8)) I |= *input++ << byte * 8;
-
-  auto suffixes = SuffixArray(input);
+  if(size == 0) return output;
 
   auto L = input;
-  auto F = new u8[size];
-  for(u32 offset : range(size)) F[offset] = L[suffixes[offset + 1]];
-
-  u64 K[256] = {};
-  auto C = new s32[size];
-  for(u32 i : range(size)) {
-    C[i] = K[L[i]];
-    K[L[i]]++;
-  }
 
-  s32 M[256];
-  memory::fill<s32>(M, 256, -1);
-  for(u32 i : range(size)) {
-    if(M[F[i]] == -1) M[F[i]] = i;
-  }
+  u32 K[256] = {};
+  for(u32 i : range(size)) K[L[i]]++;
+
+  u32 M[256];
+  for(u32 c = 0, sum = 0; c < 256; c++) M[c] = sum, sum += K[c];
+
+  auto LF = new u32[size];
+  for(u32 i : range(size)) LF[i] = M[L[i]]++;
 
   u32 i = I;
   for(u32 j : reverse(range(size))) {
     output[j] = L[i];
-    i = C[i] + M[L[i]];
+    i = LF[i];
   }
 
+  delete[] LF;
   return output;
 }
 
@@ -2,34 +2,186 @@
 
 namespace nall::Decode {
 
-inline auto Huffman(array_view<u8> input) -> vector<u8> {
-  vector<u8> output;
+//decodes a Huffman stream incrementally, so that several streams can be consumed side by side without buffering them
+//codes are decoded through a lookup table indexed by the next (up to) eleven bits of input:
+//each entry holds every whole code that fits in those bits (up to two), or for longer codes,
+//the tree node reached after them, from which decoding continues a bit at a time
+//reads past the end of the input return zeroes, so that malformed streams cannot read out of bounds
 
-  u32 size = 0;
-  for(u32 byte : range(8)) size |= *input++ << byte * 8;
-  output.reserve(size);
+struct HuffmanReader {
+  HuffmanReader(array_view<u8> input = {});
 
-  u32 byte = 0, bits = 0;
-  auto read = [&]() -> bool {
-    if(bits == 0) bits = 8, byte = *input++;
-    return byte >> --bits & 1;
-  };
+  auto size() const -> u32 { return _size; }
+  auto remaining() const -> u32 { return _remaining + _chunkSize - _chunkOffset; }
+
+  //decodes up to count symbols into target; returns the number decoded
+  auto read(u8* target, u32 count) -> u32;
+
+  //decodes a single symbol, or zero once the stream is exhausted; symbols are decoded a chunk at a time behind the scenes
+  auto read() -> u8 {
+    if(_chunkOffset == _chunkSize) {
+      _chunkOffset = 0;
+      _chunkSize = decode(_chunk, min(_remaining, (u32)sizeof(_chunk)));
+      _remaining -= _chunkSize;
+      if(!_chunkSize) return 0;
+    }
+    return _chunk[_chunkOffset++];
+  }
+
+private:
+  auto decode(u8* target, u32 count) -> u32;
 
-  u32 nodes[256][2] = {};
+  array_view<u8> _input;
+  u64 _buffer = 0;
+  u32 _bits = 0;
+  u32 _size = 0;
+  u32 _remaining = 0;
+  u32 _tableBits = 0;
+  u32 _nodes[256][2] = {};
+  //entry: symbols (2x8 bits) | count (2 bits) << 16 | total length (4 bits) << 18 | first length (4 bits) << 22,
+  //or node << 22 when count is zero
+  u32 _table[2048];
+  u32 _chunkOffset = 0;
+  u32 _chunkSize = 0;
+  u8  _chunk[64];
+};
+
+inline HuffmanReader::HuffmanReader(array_view<u8> input) : _input(input) {
+  for(u32 byte : range(8)) _size |= (u64)input(byte) << byte * 8;
+  _input += min(8, _input.size());
+  _remaining = _size;
+
+  //the tree is 256 * 18 bits: it always ends on a byte boundary
+  u32 buffer = 0, bits = 0;
+  auto read = [&](u32 count) -> u32 {
+    while(bits < count) buffer = buffer << 8 | (_input.size() ? *_input++ : 0), bits += 8;
+    return buffer >> (bits -= count) & (1 << count) - 1;
+  };
   for(u32 offset : range(256)) {
-    for(u32 index : range(9)) nodes[offset][0] = nodes[offset][0] << 1 | read();
-    for(u32 index : range(9)) nodes[offset][1] = nodes[offset][1] << 1 | read();
+    _nodes[offset][0] = read(9);
+    _nodes[offset][1] = read(9);
   }
 
-  u32 node = 511;
-  while(output.size() < size) {
-    node = nodes[node - 256][read()];
+  //short streams are not worth building a full table for
+  _tableBits = _size < 256 ? 6 : _size < 4096 ? 9 : 11;
+  const u32 tableSize = 1 << _tableBits;
+  u32 single[2048];
+  memset(single, 0, tableSize * sizeof(u32));  //entries a malformed tree leaves unreached decode as zeroes
+
+  //first, the codes of at most tableBits bits: each fills every entry that it is a prefix of
+  struct Walk { u32 node, depth, prefix; } stack[24];
+  u32 depth = 0;
+  stack[depth++] = {511, 0, 0};
+  while(depth) {
+    auto [node, length, prefix] = stack[--depth];
     if(node < 256) {
-      output.append(node);
-      node = 511;
+      if(length == 0) continue;  //malformed: a leaf cannot be the root
+      u32 entry = node | 1 << 16 | length << 18;
+      for(u32 fill : range(1 << _tableBits - length)) single[prefix << _tableBits - length | fill] = entry;
+    } else if(length == _tableBits) {
+      single[prefix] = node << 22 | _tableBits << 18;
+    } else {
+      stack[depth++] = {_nodes[node - 256][1], length + 1, prefix << 1 | 1};
+      stack[depth++] = {_nodes[node - 256][0], length + 1, prefix << 1 | 0};
+    }
+  }
+
+  //then, pair each short code with the code that follows it, when that also fits
+  for(u32 index : range(tableSize)) {
+    u32 entry = single[index];
+    _table[index] = entry;
+    u32 length = entry >> 18 & 15;
+    if((entry >> 16 & 3) != 1 || length == _tableBits) continue;
+    u32 next = single[index << length & tableSize - 1];
+    u32 nextLength = next >> 18 & 15;
+    if((next >> 16 & 3) != 1 || length + nextLength > _tableBits) continue;
+    _table[index] = (entry & 0xff) | (next & 0xff) << 8 | 2 << 16 | length + nextLength << 18 | length << 22;
+  }
+}
+
+inline auto HuffmanReader::read(u8* target, u32 count) -> u32 {
+  u32 cached = min(count, _chunkSize - _chunkOffset);
+  if(cached) memcpy(target, _chunk + _chunkOffset, cached);
+  _chunkOffset += cached;
+  u32 decoded = decode(target + cached, min(count - cached, _remaining));
+  _remaining -= decoded;
+  return cached + decoded;
+}
+
+inline auto HuffmanReader::decode(u8* target, u32 count) -> u32 {
+  //the state is kept in locals: stores through target could otherwise alias it
+  auto input = _input;
+  u64 buffer = _buffer;
+  u32 bits = _bits;
+  const u32 tableBits = _tableBits;
+
+  //bits are refilled into a 64-bit buffer, most significant first
+  //whole words are loaded while enough input remains: bytes that do not fit are consumed again by the next refill
+  auto refill = [&] {
+    if(input.size() >= 8) {
+      u64 word = 0;
+      for(u32 byte : range(8)) word = word << 8 | input[byte];
+      buffer |= word >> bits;
+      u32 bytes = 63 - bits >> 3;
+      input += bytes;
+      bits += bytes * 8;
+      return;
+    }
+    while(bits <= 56) {
+      buffer |= (u64)(input.size() ? *input++ : 0) << 56 - bits;
+      bits += 8;
+    }
+  };
+  auto peek = [&](u32 count) -> u32 { return buffer >> 64 - count; };
+  auto skip = [&](u32 count) { buffer <<= count, bits -= count; };
+
+  u8* end = target + count;
+  while(target < end) {
+    refill();
+
+    //a refill leaves at least 56 bits buffered: enough for several lookups
+    //both symbols of an entry are always stored, but the target only advances past those decoded
+    while(bits >= tableBits && end - target >= 2) {
+      u32 entry = _table[peek(tableBits)];
+      u32 symbols = entry >> 16 & 3;
+      if(!symbols) break;
+      target[0] = entry;
+      target[1] = entry >> 8;
+      target += symbols;
+      skip(entry >> 18 & 15);
+    }
+    if(target == end) break;
+
+    refill();
+    u32 entry = _table[peek(tableBits)];
+    u32 symbols = entry >> 16 & 3;
+    if(symbols) {
+      *target++ = entry;
+      skip(symbols == 2 ? entry >> 22 & 15 : entry >> 18 & 15);  //a pair where only the first symbol remains
+    } else {
+      //long code: continue through the tree a bit at a time (no valid code is longer than 255 bits)
+      skip(tableBits);
+      u32 node = entry >> 22;
+      for(u32 step = 0; node >= 256 && step < 256; step++) {
+        if(!bits) refill();
+        node = _nodes[node - 256][peek(1)];
+        skip(1);
+      }
+      *target++ = node;
     }
   }
 
+  _input = input;
+  _buffer = buffer;
+  _bits = bits;
+  return count;
+}
+
+inline auto Huffman(array_view<u8> input) -> vector<u8> {
+  HuffmanReader reader{input};
+  vector<u8> output;
+  output.resize(reader.size());
+  reader.read(output.data(), output.size());
   return output;
 }
 
@@ -3,12 +3,14 @@
 //a bad implementation of inflate from zlib/minizip
 //todo: replace with Talarubi's version
 
+#include <nall/function.hpp>
+
 #include <setjmp.h>
 
 namespace nall::Decode {
 
 namespace puff {
-  inline auto puff(u8* dest, u32* destlen, u8* source, u32* sourcelen) -> s32;
+  inline auto puff(u8* dest, u32* destlen, u8* source, u32* sourcelen, const function<bool (const u8*, u32)>* sink = nullptr) -> s32;
 }
 
 inline auto inflate(u8* target, u32 targetLength, const u8* source, u32 sourceLength) -> bool {
@@ -25,12 +27,17 @@ enum : u32 {
   MAXDCODES =  30,
   FIXLCODES = 288,
   MAXCODES  = MAXLCODES + MAXDCODES,
+  WINDOW    = 65536,  //streaming window: holds the 32KiB history, plus output not yet handed to the sink
+  FLUSH     = 16384,  //output accumulated before it is handed to the sink
 };
 
 struct state {
   u8* out;
   u32 outlen;
   u32 outcnt;
+  u32 outmask;     //~0 for a flat output buffer; WINDOW - 1 when streaming
+  u32 outflushed;  //output already handed to the sink
+  const function<bool (const u8*, u32)>* sink;
 
   u8* in;
   u32 inlen;
@@ -62,6 +69,16 @@ inline auto bits(state* s, s32 need) -> s32 {
   return (s32)(val & ((1L << need) - 1));
 }
 
+inline auto flush(state* s) -> bool {
+  while(s->outflushed != s->outcnt) {
+    u32 offset = s->outflushed & s->outmask;
+    u32 length = min(s->outcnt - s->outflushed, s->outmask + 1 - offset);
+    if(!(*s->sink)(s->out + offset, length)) return false;
+    s->outflushed += length;
+  }
+  return true;
+}
+
 inline auto stored(state* s) -> s32 {
   u32 len;
 
@@ -78,7 +95,10 @@ inline auto stored(state* s) -> s32 {
   if(s->incnt + len > s->inlen) return 2;
   if(s->out != nullptr) {
     if(s->outcnt + len > s->outlen) return 1;
-    while(len--) s->out[s->outcnt++] = s->in[s->incnt++];
+    while(len--) {
+      s->out[s->outcnt++ & s->outmask] = s->in[s->incnt++];
+      if(s->sink && s->outcnt - s->outflushed >= FLUSH && !flush(s)) return -12;
+    }
   } else {
     s->outcnt += len;
     s->incnt += len;
@@ -175,7 +195,7 @@ inline auto codes(state* s, huffman* lencode, huffman* distcode) -> s32 {
     if(symbol < 256) {
       if(s->out != nullptr) {
         if(s->outcnt == s->outlen) return 1;
-        s->out[s->outcnt] = symbol;
+        s->out[s->outcnt & s->outmask] = symbol;
       }
       s->outcnt++;
     } else if(symbol > 256) {
@@ -193,17 +213,18 @@ inline auto codes(state* s, huffman* lencode, huffman* distcode) -> s32 {
       if(s->out != nullptr) {
         if(s->outcnt + len > s->outlen) return 1;
         while(len--) {
-          s->out[s->outcnt] =
+          s->out[s->outcnt & s->outmask] =
           #ifdef INFLATE_ALLOW_INVALID_DISTANCE_TOO_FAR
           dist > s->outcnt ? 0 :
           #endif
-          s->out[s->outcnt - dist];
+          s->out[(s->outcnt - dist) & s->outmask];
           s->outcnt++;
         }
       } else {
         s->outcnt += len;
       }
     }
+    if(s->sink && s->outcnt - s->outflushed >= FLUSH && !flush(s)) return -12;
   } while(symbol != 256);
 
   return 0;
@@ -299,13 +320,16 @@ inline auto dynamic(state* s) -> s32 {
   return codes(s, &lencode, &distcode);
 }
 
-inline auto puff(u8* dest, u32* destlen, u8* source, u32* sourcelen) -> s32 {
+inline auto puff(u8* dest, u32* destlen, u8* source, u32* sourcelen, const function<bool (const u8*, u32)>* sink) -> s32 {
   state s;
   s32 last, type, err;
 
   s.out = dest;
   s.outlen = *destlen;
   s.outcnt = 0;
+  s.outmask = sink ? WINDOW - 1 : ~0u;
+  s.outflushed = 0;
+  s.sink = sink;
 
   s.in = source;
   s.inlen = *sourcelen;
@@ -325,6 +349,7 @@ inline auto puff(u8* dest, u32* destlen, u8* source, u32* sourcelen) -> s32 {
           : -1;
       if(err != 0) break;
     } while(!last);
+    if(err == 0 && sink && !flush(&s)) err = -12;
   }
 
   if(err <= 0) {
@@ -337,4 +362,14 @@ inline auto puff(u8* dest, u32* destlen, u8* source, u32* sourcelen) -> s32 {
 
 }
 
+//streaming variant: output is decoded into a sliding window, rather than one buffer holding the entire result,
+//and handed to sink in order as it is produced; sink returns false to abort
+inline auto inflate(const u8* source, u32 sourceLength, const function<bool (const u8* data, u32 length)>& sink) -> bool {
+  auto window = new u8[puff::WINDOW];
+  u32 tl = ~0u, sl = sourceLength;
+  s32 result = puff::puff(window, &tl, (u8*)source, &sl, &sink);
+  delete[] window;
+  return result == 0;
+}
+
 }
@@ -4,68 +4,140 @@
 
 namespace nall::Decode {
 
-inline auto LZSA(array_view<u8> input) -> vector<u8> {
-  vector<u8> output;
-  u32 index = 0;
-
-  u32 size = 0;
-  for(u32 byte : range(8)) size |= *input++ << byte * 8;
-  output.resize(size);
-
-  auto load = [&]() -> vector<u8> {
-    u32 size = 0;
-    for(u32 byte : range(8)) size |= *input++ << byte * 8;
-    vector<u8> buffer;
-    buffer.reserve(size);
-    while(size--) buffer.append(*input++);
-    return buffer;
+//decodes one stream into output, after the `index` bytes of dictionary already there; returns false if the stream is malformed
+//the four Huffman streams are read side by side, straight into output
+//when Safe is set, every length and offset is checked against the input and output; otherwise the input is trusted to be valid,
+//except that match lengths are always checked, so that no mode ever writes past the end of output or fails to terminate
+template<bool Safe>
+inline auto LZSAStream(array_view<u8> input, array_span<u8> output, u32 index) -> bool {
+  auto read64 = [&]() -> u64 {
+    u64 value = 0;
+    for(u32 byte : range(8)) value |= (u64)input(byte) << byte * 8;
+    input += min(8, input.size());
+    return value;
   };
 
-  auto flags = Decode::Huffman(load());
-  auto literals = Decode::Huffman(load());
-  auto lengths = Decode::Huffman(load());
-  auto offsets = Decode::Huffman(load());
+  u64 size = read64();
+  if(index > output.size() || size > output.size() - index) return false;
+  size += index;
 
-  auto flagData = flags.data();
-  u32  byte = 0, bits = 0;
-  auto flagRead = [&]() -> bool {
-    if(bits == 0) bits = 8, byte = *flagData++;
-    return byte >> --bits & 1;
-  };
+  array_view<u8> streams[4];
+  for(auto& stream : streams) {
+    u64 length = read64();
+    if(Safe && length > input.size()) return false;
+    stream = {input.data(), length};
+    input += length;
+  }
 
-  auto literalData = literals.data();
-  auto literalRead = [&]() -> u8 {
-    return *literalData++;
-  };
+  HuffmanReader flags{streams[0]};
+  HuffmanReader literals{streams[1]};
+  HuffmanReader lengths{streams[2]};
+  HuffmanReader offsets{streams[3]};
 
-  auto lengthData = lengths.data();
-  auto lengthRead = [&]() -> u64 {
-    u32 byte = *lengthData++, bytes = 1;
-    while(!(byte & 1)) byte >>= 1, bytes++;
-    u32 length = byte >> 1, shift = 8 - bytes;
-    while(--bytes) length |= *lengthData++ << shift, shift += 8;
-    return length;
-  };
+  u8* target = output.data();
+  u32 byte = 0, bits = 0;
+  while(index < size) {
+    if(bits == 0) bits = 8, byte = flags.read();
+    if(!(byte >> --bits & 1)) {
+      target[index++] = literals.read();
+      continue;
+    }
 
-  auto offsetData = offsets.data();
-  auto offsetRead = [&]() -> u32 {
-    u32 offset = 0;
-    offset |= *offsetData++ <<  0; if(index < 1 <<  8) return offset;
-    offset |= *offsetData++ <<  8; if(index < 1 << 16) return offset;
-    offset |= *offsetData++ << 16; if(index < 1 << 24) return offset;
-    offset |= *offsetData++ << 24; return offset;
-  };
+    u32 lengthByte = lengths.read(), lengthBytes = 1;
+    if(!lengthByte) return false;  //would never terminate the prefix scan below
+    while(!(lengthByte & 1)) lengthByte >>= 1, lengthBytes++;
+    u64 length = lengthByte >> 1, shift = 8 - lengthBytes;
+    while(--lengthBytes) length |= (u64)lengths.read() << shift, shift += 8;
+    length += 6;
 
-  while(index < size) {
-    if(!flagRead()) {
-      output[index++] = literalRead();
+    u32 distance = 0;
+    distance |= offsets.read() <<  0; if(index >= 1 <<  8) {
+    distance |= offsets.read() <<  8; if(index >= 1 << 16) {
+    distance |= offsets.read() << 16; if(index >= 1 << 24) {
+    distance |= offsets.read() << 24; }}}
+    if(length > size - index) return false;
+    if(Safe && (distance == 0 || distance > index)) return false;
+
+    u8* to = target + index;
+    const u8* from = to - distance;
+    index += length;
+    if(distance >= 8 && index + 8 <= output.size()) {
+      //wildcopy: whole words, possibly writing up to seven bytes past the match that later output overwrites
+      for(u64 n = 0; n < length; n += 8) memcpy(to + n, from + n, 8);
     } else {
-      u32 length = lengthRead() + 6;
-      u32 offset = index - offsetRead();
-      while(length--) output[index++] = output[offset++];
+      //the match overlaps itself, repeating the last `distance` bytes: it must be copied in order
+      while(length--) *to++ = *from++;
     }
   }
 
+  return true;
+}
+
+//returns the decoded size of input, so that the output can be allocated ahead of LZSA(input, output)
+inline auto LZSASize(array_view<u8> input) -> u64 {
+  u64 size = 0;
+  for(u32 byte : range(8)) size |= (u64)input(byte) << byte * 8;
+  return size & ~(1ull << 63);
+}
+
+//decodes input into output, which must hold at least LZSASize(input) bytes; returns false if input is malformed
+//with safe unset, the input is trusted: malformed input may read outside of input and output and corrupt output,
+//but writes never go past the end of output
+inline auto LZSA(array_view<u8> input, array_span<u8> output, bool safe = true) -> bool {
+  auto stream = safe ? LZSAStream<true> : LZSAStream<false>;
+
+  u64 size = 0;
+  for(u32 byte : range(8)) size |= (u64)input(byte) << byte * 8;
+  if(!(size >> 63)) {
+    return size <= output.size() && stream(input, {output.data(), size}, 0);
+  }
+
+  //block mode: see Encode::LZSA
+  size &= ~(1ull << 63);
+  if(size > output.size() || input.size() < 13) return false;
+  input += 8;
+  u32 blockSize = 0;
+  for(u32 byte : range(4)) blockSize |= *input++ << byte * 8;
+  bool dictionary = *input++;
+  if(!blockSize) return false;
+
+  for(u64 start = 0; start < size; start += blockSize) {
+    if(input.size() < 8) return false;
+    u64 length = 0;
+    for(u32 byte : range(8)) length |= (u64)*input++ << byte * 8;
+    if(length > input.size()) return false;
+    u64 origin = dictionary ? start - min<u64>(start, blockSize) : start;
+    u64 end = min<u64>(size, start + blockSize);
+    if(!stream({input.data(), length}, {output.data() + origin, end - origin}, start - origin)) return false;
+    input += length;
+  }
+
+  return true;
+}
+
+//returns whether the size in the header of input is one that the encoder could have produced from that much input:
+//single streams never exceed 2^31 bytes (the encoder addresses them with s32), and every stream carries four Huffman trees
+inline auto LZSAPlausible(array_view<u8> input) -> bool {
+  static constexpr u64 StreamMinimum = 8 + 4 * (8 + 8 + 576);  //size, then four streams of length, size and tree
+  u64 size = 0;
+  for(u32 byte : range(8)) size |= (u64)input(byte) << byte * 8;
+  if(!(size >> 63)) return size == 0 || (size <= 1ull << 31 && input.size() >= StreamMinimum);
+
+  size &= ~(1ull << 63);
+  if(input.size() < 13) return false;
+  u64 blockSize = 0;
+  for(u32 byte : range(4)) blockSize |= (u64)input[8 + byte] << byte * 8;
+  if(!blockSize) return false;
+  u64 blocks = (size + blockSize - 1) / blockSize;
+  return blocks <= (input.size() - 13) / (8 + StreamMinimum);
+}
+
+//the header is not trusted: implausible sizes are rejected before anything is allocated
+inline auto LZSA(array_view<u8> input) -> vector<u8> {
+  if(!LZSAPlausible(input)) return {};
+  vector<u8> output;
+  output.resize(LZSASize(input));
+  if(!LZSA(input, array_span<u8>{output.data(), output.size()})) return {};
   return output;
 }
 
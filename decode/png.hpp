@@ -13,6 +13,12 @@ struct PNG {
   auto load(const u8* sourceData, u32 sourceSize) -> bool;
   auto readbits(const u8*& data) -> u32;
 
+  //streaming interface: parse() reads the chunks, and decode() then inflates and unfilters one row at a time,
+  //handing each row to callback as soon as it is complete, without buffering the whole image:
+  //the row holds width pixels, which belong at x, x + step, x + step * 2, ... of image row y
+  auto parse(const u8* sourceData, u32 sourceSize) -> bool;
+  auto decode(const function<void (u32 y, u32 x, u32 step, u32 width, const u8* row)>& callback) -> bool;
+
   struct Info {
     u32 width;
     u32 height;
@@ -28,6 +34,7 @@ struct PNG {
     u32 filterType;
     u32 interlaceMethod;
 
+    u32 bitsPerPixel;
     u32 bytesPerPixel;
     u32 pitch;
 
@@ -37,7 +44,10 @@ struct PNG {
   u8* data = nullptr;
   u32 size = 0;
 
+  //readbits() state: samples narrower than a byte are read from the most significant bit,
+  //and each row of data starts on a new byte
   u32 bitpos = 0;
+  u32 rowbits = 0;
 
 protected:
   enum class FourCC : u32 {
@@ -48,10 +58,13 @@ protected:
   };
 
   auto interlace(u32 pass, u32 index) -> u32;
-  auto inflateSize() -> u32;
-  auto deinterlace(const u8*& inputData, u32 pass) -> bool;
-  auto filter(u8* outputData, const u8* inputData, u32 width, u32 height) -> bool;
+  auto unfilter(u8 filter, u8* row, const u8* prior, u32 length, u32 bpp) -> bool;
+  #if defined(__SSE2__)
+  template<u32 Bpp> auto unfilterPixels(u8 filter, u8* row, const u8* prior, u32 length) -> void;
+  #endif
   auto read(const u8* data, u32 length) -> u32;
+
+  vector<u8> compressed;
 };
 
 inline PNG::PNG() {
@@ -69,18 +82,54 @@ inline auto PNG::load(const string& filename) -> bool {
 }
 
 inline auto PNG::load(const u8* sourceData, u32 sourceSize) -> bool {
+  if(!parse(sourceData, sourceSize)) return false;
+
+  size = info.height * info.pitch;
+  data = new u8[size]();
+  bitpos = 0;
+  rowbits = 0;
+
+  bool result = decode([&](u32 y, u32 x, u32 step, u32 width, const u8* row) {
+    u8* wr = data + y * info.pitch;
+    if(step == 1) return (void)memcpy(wr, row, (width * info.bitsPerPixel + 7) / 8);
+
+    //interlaced pass: scatter the pixels of the row to their final columns
+    if(info.bitsPerPixel >= 8) {
+      for(u32 n : range(width)) {
+        memcpy(wr + (x + n * step) * info.bytesPerPixel, row + n * info.bytesPerPixel, info.bytesPerPixel);
+      }
+    } else {
+      u32 bits = info.bitsPerPixel, mask = (1 << bits) - 1;
+      for(u32 n : range(width)) {
+        u32 source = n * bits, target = (x + n * step) * bits;
+        u32 pixel = row[source >> 3] >> (8 - bits - (source & 7)) & mask;
+        wr[target >> 3] |= pixel << (8 - bits - (target & 7));
+      }
+    }
+  });
+
+  if(result == false) {
+    delete[] data;
+    data = nullptr;
+    return false;
+  }
+
+  return true;
+}
+
+inline auto PNG::parse(const u8* sourceData, u32 sourceSize) -> bool {
   if(sourceSize < 8) return false;
   if(read(sourceData + 0, 4) != 0x89504e47) return false;
   if(read(sourceData + 4, 4) != 0x0d0a1a0a) return false;
 
-  u8* compressedData = nullptr;
-  u32 compressedSize = 0;
+  info = {};
+  compressed.reset();
 
   u32 offset = 8;
-  while(offset < sourceSize) {
+  while(offset + 12 <= sourceSize) {
     u32 length   = read(sourceData + offset + 0, 4);
     u32 fourCC   = read(sourceData + offset + 4, 4);
-    u32 checksum = read(sourceData + offset + 8 + length, 4);
+    if(length > sourceSize - offset - 12) return false;
 
     if(fourCC == (u32)FourCC::IHDR) {
       info.width             = read(sourceData + offset +  8, 4);
@@ -98,11 +147,11 @@ inline auto PNG::load(const u8* sourceData, u32 sourceSize) -> bool {
       if(info.interlaceMethod != 0 && info.interlaceMethod != 1) return false;
 
       switch(info.colorType) {
-      case 0: info.bytesPerPixel = info.bitDepth * 1; break;  //L
-      case 2: info.bytesPerPixel = info.bitDepth * 3; break;  //R,G,B
-      case 3: info.bytesPerPixel = info.bitDepth * 1; break;  //P
-      case 4: info.bytesPerPixel = info.bitDepth * 2; break;  //L,A
-      case 6: info.bytesPerPixel = info.bitDepth * 4; break;  //R,G,B,A
+      case 0: info.bitsPerPixel = info.bitDepth * 1; break;  //L
+      case 2: info.bitsPerPixel = info.bitDepth * 3; break;  //R,G,B
+      case 3: info.bitsPerPixel = info.bitDepth * 1; break;  //P
+      case 4: info.bitsPerPixel = info.bitDepth * 2; break;  //L,A
+      case 6: info.bitsPerPixel = info.bitDepth * 4; break;  //R,G,B,A
       default: return false;
       }
 
@@ -111,12 +160,13 @@ inline auto PNG::load(const u8* sourceData, u32 sourceSize) -> bool {
       }
       if(info.colorType == 3 && info.bitDepth == 16) return false;
 
-      info.bytesPerPixel = (info.bytesPerPixel + 7) / 8;
-      info.pitch = (s32)info.width * info.bytesPerPixel;
+      //pixels narrower than a byte are packed, and each row is padded to a whole byte
+      info.bytesPerPixel = (info.bitsPerPixel + 7) / 8;
+      info.pitch = ((u64)info.width * info.bitsPerPixel + 7) / 8;
     }
 
     if(fourCC == (u32)FourCC::PLTE) {
-      if(length % 3) return false;
+      if(length % 3 || length > 256 * 3) return false;
       for(u32 n = 0, p = offset + 8; n < length / 3; n++) {
         info.palette[n][0] = sourceData[p++];
         info.palette[n][1] = sourceData[p++];
@@ -125,9 +175,9 @@ inline auto PNG::load(const u8* sourceData, u32 sourceSize) -> bool {
     }
 
     if(fourCC == (u32)FourCC::IDAT) {
-      compressedData = (u8*)realloc(compressedData, compressedSize + length);
-      memcpy(compressedData + compressedSize, sourceData + offset + 8, length);
-      compressedSize += length;
+      u32 position = compressed.size();
+      compressed.resize(position + length);
+      memcpy(compressed.data() + position, sourceData + offset + 8, length);
     }
 
     if(fourCC == (u32)FourCC::IEND) {
@@ -137,41 +187,63 @@ inline auto PNG::load(const u8* sourceData, u32 sourceSize) -> bool {
     offset += 4 + 4 + length + 4;
   }
 
-  u32  interlacedSize = inflateSize();
-  auto interlacedData = new u8[interlacedSize];
-
-  bool result = inflate(interlacedData, interlacedSize, compressedData + 2, compressedSize - 6);
-  free(compressedData);
-
-  if(result == false) {
-    delete[] interlacedData;
-    return false;
-  }
-
-  size = info.width * info.height * info.bytesPerPixel;
-  data = new u8[size];
+  return info.width && info.height && compressed.size() >= 6;
+}
 
-  if(info.interlaceMethod == 0) {
-    if(filter(data, interlacedData, info.width, info.height) == false) {
-      delete[] interlacedData;
-      delete[] data;
-      data = nullptr;
-      return false;
+inline auto PNG::decode(const function<void (u32 y, u32 x, u32 step, u32 width, const u8* row)>& callback) -> bool {
+  u32 bpp = info.bytesPerPixel;
+
+  //the filter type byte, then the filtered row; the previous row of the pass is needed to unfilter the next
+  vector<u8> buffer;
+  buffer.resize((info.pitch + 1) * 3);
+  u8* current = buffer.data();
+  u8* prior = current + info.pitch + 1;
+  const u8* zero = prior + info.pitch + 1;
+
+  u32 pass = info.interlaceMethod ? 0 : 7;
+  u32 xd, yd, xo, yo, width, height, pitch;
+  u32 y = 0, fill = 0;
+
+  //advance to the next pass that contains pixels; pass 7 is the whole image of a non-interlaced PNG
+  auto select = [&]() -> bool {
+    for(; pass <= 7; pass++) {
+      if(pass == 7) {
+        if(info.interlaceMethod) return false;
+        xd = yd = 1, xo = yo = 0;
+      } else {
+        xd = interlace(pass, 0), yd = interlace(pass, 1);
+        xo = interlace(pass, 2), yo = interlace(pass, 3);
+      }
+      width  = (info.width  + (xd - xo - 1)) / xd;
+      height = (info.height + (yd - yo - 1)) / yd;
+      pitch  = ((u64)width * info.bitsPerPixel + 7) / 8;
+      if(width && height) return true;
     }
-  } else {
-    const u8* passData = interlacedData;
-    for(u32 pass = 0; pass < 7; pass++) {
-      if(deinterlace(passData, pass) == false) {
-        delete[] interlacedData;
-        delete[] data;
-        data = nullptr;
-        return false;
+    return false;
+  };
+  bool active = select();
+
+  bool result = inflate(compressed.data() + 2, compressed.size() - 6, [&](const u8* input, u32 length) -> bool {
+    while(length && active) {
+      u32 count = min(pitch + 1 - fill, length);
+      memcpy(current + fill, input, count);
+      input += count, length -= count, fill += count;
+      if(fill < pitch + 1) break;
+
+      if(!unfilter(current[0], current + 1, y ? prior + 1 : zero + 1, pitch, bpp)) return false;
+      callback(yo + y * yd, xo, xd, width, current + 1);
+      std::swap(current, prior);
+      fill = 0;
+
+      if(++y == height) {
+        y = 0, pass++;
+        active = select();
       }
     }
-  }
+    return true;  //any data past the final row is ignored
+  });
 
-  delete[] interlacedData;
-  return true;
+  return result && !active;
 }
 
 inline auto PNG::interlace(u32 pass, u32 index) -> u32 {
@@ -188,111 +260,119 @@ inline auto PNG::interlace(u32 pass, u32 index) -> u32 {
   return data[pass][index];
 }
 
-inline auto PNG::inflateSize() -> u32 {
-  if(info.interlaceMethod == 0) {
-    return info.width * info.height * info.bytesPerPixel + info.height;
-  }
+//reverses the filter of one row in place: a = left, b = above, c = above-left
+inline auto PNG::unfilter(u8 filter, u8* row, const u8* prior, u32 length, u32 bpp) -> bool {
+  if(filter > 0x04) return false;  //invalid
 
-  u32 size = 0;
-  for(u32 pass = 0; pass < 7; pass++) {
-    u32 xd = interlace(pass, 0), yd = interlace(pass, 1);
-    u32 xo = interlace(pass, 2), yo = interlace(pass, 3);
-    u32 width  = (info.width  + (xd - xo - 1)) / xd;
-    u32 height = (info.height + (yd - yo - 1)) / yd;
-    if(width == 0 || height == 0) continue;
-    size += width * height * info.bytesPerPixel + height;
+  #if defined(__SSE2__)
+  //8-bit R,G,B and R,G,B,A rows are unfiltered a whole pixel at a time
+  if(filter != 0x02 && length % bpp == 0) {
+    if(bpp == 3) return unfilterPixels<3>(filter, row, prior, length), true;
+    if(bpp == 4) return unfilterPixels<4>(filter, row, prior, length), true;
   }
-  return size;
-}
+  #endif
 
-inline auto PNG::deinterlace(const u8*& inputData, u32 pass) -> bool {
-  u32 xd = interlace(pass, 0), yd = interlace(pass, 1);
-  u32 xo = interlace(pass, 2), yo = interlace(pass, 3);
-  u32 width  = (info.width  + (xd - xo - 1)) / xd;
-  u32 height = (info.height + (yd - yo - 1)) / yd;
-  if(width == 0 || height == 0) return true;
+  switch(filter) {
+  case 0x00:  //None
+    break;
 
-  u32 outputSize = width * height * info.bytesPerPixel;
-  auto outputData = new u8[outputSize];
-  bool result = filter(outputData, inputData, width, height);
+  case 0x01:  //Subtract
+    for(u32 x = bpp; x < length; x++) row[x] += row[x - bpp];
+    break;
 
-  const u8* rd = outputData;
-  for(u32 y = yo; y < info.height; y += yd) {
-    u8* wr = data + y * info.pitch;
-    for(u32 x = xo; x < info.width; x += xd) {
-      for(u32 b = 0; b < info.bytesPerPixel; b++) {
-        wr[x * info.bytesPerPixel + b] = *rd++;
-      }
+  case 0x02: {  //Above
+    u32 x = 0;
+    #if defined(__SSE2__)
+    for(; x + 16 <= length; x += 16) {
+      __m128i a = _mm_loadu_si128((const __m128i*)(row + x));
+      __m128i b = _mm_loadu_si128((const __m128i*)(prior + x));
+      _mm_storeu_si128((__m128i*)(row + x), _mm_add_epi8(a, b));
     }
+    #endif
+    for(; x < length; x++) row[x] += prior[x];
+    break;
   }
 
-  inputData += outputSize + height;
-  delete[] outputData;
-  return result;
-}
-
-inline auto PNG::filter(u8* outputData, const u8* inputData, u32 width, u32 height) -> bool {
-  u8* wr = outputData;
-  const u8* rd = inputData;
-  s32 bpp = info.bytesPerPixel, pitch = width * bpp;
-  for(s32 y = 0; y < height; y++) {
-    u8 filter = *rd++;
-
-    switch(filter) {
-    case 0x00:  //None
-      for(s32 x = 0; x < pitch; x++) {
-        wr[x] = rd[x];
-      }
-      break;
-
-    case 0x01:  //Subtract
-      for(s32 x = 0; x < pitch; x++) {
-        wr[x] = rd[x] + (x - bpp < 0 ? 0 : wr[x - bpp]);
-      }
-      break;
+  case 0x03:  //Average
+    for(u32 x = 0; x < bpp && x < length; x++) row[x] += prior[x] >> 1;
+    for(u32 x = bpp; x < length; x++) row[x] += (row[x - bpp] + prior[x]) >> 1;
+    break;
 
-    case 0x02:  //Above
-      for(s32 x = 0; x < pitch; x++) {
-        wr[x] = rd[x] + (y - 1 < 0 ? 0 : wr[x - pitch]);
-      }
-      break;
+  case 0x04:  //Paeth
+    for(u32 x = 0; x < length; x++) {
+      s16 a = x < bpp ? 0 : row[x - bpp];
+      s16 b = prior[x];
+      s16 c = x < bpp ? 0 : prior[x - bpp];
 
-    case 0x03:  //Average
-      for(s32 x = 0; x < pitch; x++) {
-        s16 a = x - bpp < 0 ? 0 : wr[x - bpp];
-        s16 b = y - 1 < 0 ? 0 : wr[x - pitch];
+      s16 p = a + b - c;
+      s16 pa = p > a ? p - a : a - p;
+      s16 pb = p > b ? p - b : b - p;
+      s16 pc = p > c ? p - c : c - p;
 
-        wr[x] = rd[x] + (u8)((a + b) / 2);
-      }
-      break;
+      auto paeth = (u8)((pa <= pb && pa <= pc) ? a : (pb <= pc) ? b : c);
 
-    case 0x04:  //Paeth
-      for(s32 x = 0; x < pitch; x++) {
-        s16 a = x - bpp < 0 ? 0 : wr[x - bpp];
-        s16 b = y - 1 < 0 ? 0 : wr[x - pitch];
-        s16 c = x - bpp < 0 || y - 1 < 0 ? 0 : wr[x - pitch - bpp];
+      row[x] += paeth;
+    }
+    break;
+  }
 
-        s16 p = a + b - c;
-        s16 pa = p > a ? p - a : a - p;
-        s16 pb = p > b ? p - b : b - p;
-        s16 pc = p > c ? p - c : c - p;
+  return true;
+}
 
-        auto paeth = (u8)((pa <= pb && pa <= pc) ? a : (pb <= pc) ? b : c);
+#if defined(__SSE2__)
+//Sub, Average and Paeth depend on the pixel to the left, so each step unfilters all channels of one pixel
+template<u32 Bpp> inline auto PNG::unfilterPixels(u8 filter, u8* row, const u8* prior, u32 length) -> void {
+  auto load = [](const u8* data) -> __m128i {
+    u32 value = 0;
+    memcpy(&value, data, Bpp);
+    return _mm_cvtsi32_si128(value);
+  };
+  auto store = [](u8* data, __m128i value) {
+    u32 result = _mm_cvtsi128_si32(value);
+    memcpy(data, &result, Bpp);
+  };
 
-        wr[x] = rd[x] + paeth;
-      }
-      break;
+  const __m128i zero = _mm_setzero_si128();
+  __m128i a = zero;
 
-    default:  //Invalid
-      return false;
+  if(filter == 0x01) {  //Subtract
+    for(u32 x = 0; x < length; x += Bpp) {
+      a = _mm_add_epi8(load(row + x), a);
+      store(row + x, a);
     }
+  }
 
-    rd += pitch;
-    wr += pitch;
+  if(filter == 0x03) {  //Average
+    //avg_epu8 rounds up, where the filter truncates
+    const __m128i one = _mm_set1_epi8(1);
+    for(u32 x = 0; x < length; x += Bpp) {
+      __m128i b = load(prior + x);
+      __m128i average = _mm_sub_epi8(_mm_avg_epu8(a, b), _mm_and_si128(_mm_xor_si128(a, b), one));
+      a = _mm_add_epi8(load(row + x), average);
+      store(row + x, a);
+    }
   }
 
-  return true;
+  if(filter == 0x04) {  //Paeth
+    //the predictor is evaluated in 16-bit lanes: |p - a| = |b - c|, |p - b| = |a - c|, |p - c| = |a + b - 2c|
+    auto absolute = [&](__m128i x) { return _mm_max_epi16(x, _mm_sub_epi16(zero, x)); };
+    auto select = [&](__m128i mask, __m128i x, __m128i y) { return _mm_or_si128(_mm_and_si128(mask, x), _mm_andnot_si128(mask, y)); };
+    __m128i c = zero;
+    for(u32 x = 0; x < length; x += Bpp) {
+      __m128i b = _mm_unpacklo_epi8(load(prior + x), zero);
+      __m128i pa = _mm_sub_epi16(b, c);
+      __m128i pb = _mm_sub_epi16(a, c);
+      __m128i pc = absolute(_mm_add_epi16(pa, pb));
+      pa = absolute(pa), pb = absolute(pb);
+      __m128i smallest = _mm_min_epi16(pc, _mm_min_epi16(pa, pb));
+      __m128i nearest = select(_mm_cmpeq_epi16(pa, smallest), a, select(_mm_cmpeq_epi16(pb, smallest), b, c));
+      a = _mm_unpacklo_epi8(_mm_add_epi8(load(row + x), _mm_packus_epi16(nearest, nearest)), zero);
+      store(row + x, _mm_packus_epi16(a, a));
+      c = b;
+    }
+  }
 }
+#endif
 
 inline auto PNG::read(const u8* data, u32 length) -> u32 {
   u32 result = 0;
@@ -304,18 +384,12 @@ inline auto PNG::readbits(const u8*& data) -> u32 {
   u32 result = 0;
   switch(info.bitDepth) {
   case 1:
-    result = (*data >> bitpos) & 1;
-    bitpos++;
-    if(bitpos == 8) { data++; bitpos = 0; }
-    break;
   case 2:
-    result = (*data >> bitpos) & 3;
-    bitpos += 2;
-    if(bitpos == 8) { data++; bitpos = 0; }
-    break;
   case 4:
-    result = (*data >> bitpos) & 15;
-    bitpos += 4;
+    result = *data >> (8 - info.bitDepth - bitpos) & (1 << info.bitDepth) - 1;
+    bitpos += info.bitDepth;
+    rowbits += info.bitDepth;
+    if(rowbits == info.width * info.bitsPerPixel) rowbits = 0, bitpos = 8;  //skip the padding at the end of the row
     if(bitpos == 8) { data++; bitpos = 0; }
     break;
   case 8:
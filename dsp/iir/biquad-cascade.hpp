@@ -0,0 +1,173 @@
+#pragma once
+
+#include <nall/dsp/iir/biquad.hpp>
+
+//chains of biquad sections, processed a block at a time
+//sections are applied one after another over the whole block, so that each section's coefficients and state stay in registers
+
+namespace nall::DSP::IIR {
+
+//single channel of f64 samples
+struct BiquadCascade {
+  auto reset(u32 sections) -> void;  //every section starts out as a pass-through filter
+  auto sections() const -> u32 { return _sections.size(); }
+  auto section(u32 index) -> Biquad& { return _sections[index]; }
+  auto process(f64 in) -> f64;
+  auto process(array_span<f64> samples) -> void;
+  auto serialize(serializer&) -> void;
+
+private:
+  vector<Biquad> _sections;
+};
+
+inline auto BiquadCascade::reset(u32 sections) -> void {
+  _sections.reset();
+  _sections.resize(sections);
+}
+
+inline auto BiquadCascade::process(f64 in) -> f64 {
+  for(auto& section : _sections) in = section.process(in);
+  return in;
+}
+
+inline auto BiquadCascade::process(array_span<f64> samples) -> void {
+  for(auto& section : _sections) section.process(samples);
+}
+
+inline auto BiquadCascade::serialize(serializer& s) -> void {
+  for(auto& section : _sections) s(section);
+}
+
+//interleaved frames of several channels, all filtered by the same chain of sections
+//channels are mapped onto SIMD lanes: four at a time for f32, two at a time for f64
+template<typename T>
+struct BiquadFrames {
+  static_assert(is_same_v<T, f32> || is_same_v<T, f64>);
+
+  auto reset(u32 channels, u32 sections) -> void;
+  auto reset(u32 section, Biquad::Type type, f64 cutoffFrequency, f64 samplingFrequency, f64 quality, f64 gain = 0.0) -> void;
+  auto channels() const -> u32 { return _channels; }
+  auto sections() const -> u32 { return _sections; }
+  auto process(array_span<T> samples) -> void;  //filters whole frames in place
+  auto serialize(serializer&) -> void;
+
+private:
+  auto process(u32 section, T* data, u32 frames) -> void;
+
+  u32 _channels = 0;
+  u32 _sections = 0;
+  vector<T> _coefficients;  //a0, a1, a2, b1, b2 of each section
+  vector<T> _state;         //z1 of each channel, then z2 of each channel, for each section
+};
+
+template<typename T>
+inline auto BiquadFrames<T>::reset(u32 channels, u32 sections) -> void {
+  _channels = channels;
+  _sections = sections;
+  _coefficients.reset();
+  _coefficients.resize(sections * 5);
+  for(u32 section : range(sections)) _coefficients[section * 5] = 1.0;
+  _state.reset();
+  _state.resize(sections * channels * 2);
+}
+
+template<typename T>
+inline auto BiquadFrames<T>::reset(u32 section, Biquad::Type type, f64 cutoffFrequency, f64 samplingFrequency, f64 quality, f64 gain) -> void {
+  Biquad design;
+  design.reset(type, cutoffFrequency, samplingFrequency, quality, gain);
+  T* coefficients = _coefficients.data() + section * 5;
+  coefficients[0] = design.a0;
+  coefficients[1] = design.a1;
+  coefficients[2] = design.a2;
+  coefficients[3] = design.b1;
+  coefficients[4] = design.b2;
+  T* state = _state.data() + section * _channels * 2;
+  for(u32 n : range(_channels * 2)) state[n] = 0.0;
+}
+
+template<typename T>
+inline auto BiquadFrames<T>::process(array_span<T> samples) -> void {
+  if(!_channels) return;
+  u32 frames = samples.size() / _channels;
+  for(u32 section : range(_sections)) process(section, samples.data(), frames);
+}
+
+template<typename T>
+inline auto BiquadFrames<T>::process(u32 section, T* data, u32 frames) -> void {
+  const T* k = _coefficients.data() + section * 5;
+  T* z1 = _state.data() + section * _channels * 2;
+  T* z2 = z1 + _channels;
+  const u32 stride = _channels;
+  u32 c = 0;
+
+  #if defined(__SSE2__)
+  if constexpr(is_same_v<T, f32>) {
+    __m128 a0 = _mm_set1_ps(k[0]), a1 = _mm_set1_ps(k[1]), a2 = _mm_set1_ps(k[2]);
+    __m128 b1 = _mm_set1_ps(k[3]), b2 = _mm_set1_ps(k[4]);
+    for(; c + 4 <= _channels; c += 4) {
+      __m128 s1 = _mm_loadu_ps(z1 + c), s2 = _mm_loadu_ps(z2 + c);
+      T* p = data + c;
+      for(u32 frame = 0; frame < frames; frame++, p += stride) {
+        __m128 in = _mm_loadu_ps(p);
+        __m128 out = _mm_add_ps(_mm_mul_ps(in, a0), s1);
+        s1 = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(in, a1), s2), _mm_mul_ps(b1, out));
+        s2 = _mm_sub_ps(_mm_mul_ps(in, a2), _mm_mul_ps(b2, out));
+        _mm_storeu_ps(p, out);
+      }
+      _mm_storeu_ps(z1 + c, s1), _mm_storeu_ps(z2 + c, s2);
+    }
+    //stereo, and the remainder of wider layouts, go through the low half of a register
+    //two f32 samples are moved as one 64-bit integer lane: no f64 access to f32 data, and no alignment requirement
+    auto load2 = [](const f32* p) { return _mm_castsi128_ps(_mm_loadl_epi64((const __m128i*)p)); };
+    auto store2 = [](f32* p, __m128 value) { _mm_storel_epi64((__m128i*)p, _mm_castps_si128(value)); };
+    for(; c + 2 <= _channels; c += 2) {
+      __m128 s1 = load2(z1 + c), s2 = load2(z2 + c);
+      T* p = data + c;
+      for(u32 frame = 0; frame < frames; frame++, p += stride) {
+        __m128 in = load2(p);
+        __m128 out = _mm_add_ps(_mm_mul_ps(in, a0), s1);
+        s1 = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(in, a1), s2), _mm_mul_ps(b1, out));
+        s2 = _mm_sub_ps(_mm_mul_ps(in, a2), _mm_mul_ps(b2, out));
+        store2(p, out);
+      }
+      store2(z1 + c, s1), store2(z2 + c, s2);
+    }
+  }
+  if constexpr(is_same_v<T, f64>) {
+    __m128d a0 = _mm_set1_pd(k[0]), a1 = _mm_set1_pd(k[1]), a2 = _mm_set1_pd(k[2]);
+    __m128d b1 = _mm_set1_pd(k[3]), b2 = _mm_set1_pd(k[4]);
+    for(; c + 2 <= _channels; c += 2) {
+      __m128d s1 = _mm_loadu_pd(z1 + c), s2 = _mm_loadu_pd(z2 + c);
+      T* p = data + c;
+      for(u32 frame = 0; frame < frames; frame++, p += stride) {
+        __m128d in = _mm_loadu_pd(p);
+        __m128d out = _mm_add_pd(_mm_mul_pd(in, a0), s1);
+        s1 = _mm_sub_pd(_mm_add_pd(_mm_mul_pd(in, a1), s2), _mm_mul_pd(b1, out));
+        s2 = _mm_sub_pd(_mm_mul_pd(in, a2), _mm_mul_pd(b2, out));
+        _mm_storeu_pd(p, out);
+      }
+      _mm_storeu_pd(z1 + c, s1), _mm_storeu_pd(z2 + c, s2);
+    }
+  }
+  #endif
+
+  for(; c < _channels; c++) {
+    T s1 = z1[c], s2 = z2[c];
+    T* p = data + c;
+    for(u32 frame = 0; frame < frames; frame++, p += stride) {
+      T in = *p;
+      T out = in * k[0] + s1;
+      s1 = in * k[1] + s2 - k[3] * out;
+      s2 = in * k[2] - k[4] * out;
+      *p = out;
+    }
+    z1[c] = s1, z2[c] = s2;
+  }
+}
+
+template<typename T>
+inline auto BiquadFrames<T>::serialize(serializer& s) -> void {
+  s(array_span<T>{_state.data(), _state.size()});
+}
+
+}
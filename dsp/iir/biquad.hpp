@@ -1,5 +1,7 @@
 #pragma once
 
+#include <nall/serializer.hpp>
+
 //transposed direct form II biquadratic second-order IIR filter
 
 namespace nall::DSP::IIR {
@@ -17,6 +19,8 @@ struct Biquad {
 
   auto reset(Type type, f64 cutoffFrequency, f64 samplingFrequency, f64 quality, f64 gain = 0.0) -> void;
   auto process(f64 in) -> f64;  //normalized sample (-1.0 to +1.0)
+  auto process(array_span<f64> samples) -> void;  //filters a block of samples in place
+  auto serialize(serializer&) -> void;
 
   static auto shelf(f64 gain, f64 slope) -> f64;
   static auto butterworth(u32 order, u32 phase) -> f64;
@@ -27,8 +31,10 @@ private:
   f64 samplingFrequency;
   f64 quality;             //frequency response quality
   f64 gain;                //peak gain
-  f64 a0, a1, a2, b1, b2;  //coefficients
-  f64 z1, z2;              //second-order IIR
+  f64 a0 = 1.0, a1 = 0.0, a2 = 0.0, b1 = 0.0, b2 = 0.0;  //coefficients (pass-through until reset)
+  f64 z1 = 0.0, z2 = 0.0;                                //second-order IIR
+
+  template<typename T> friend struct BiquadFrames;
 };
 
 inline auto Biquad::reset(Type type, f64 cutoffFrequency, f64 samplingFrequency, f64 quality, f64 gain) -> void {
@@ -148,6 +154,25 @@ inline auto Biquad::process(f64 in) -> f64 {
   return out;
 }
 
+inline auto Biquad::process(array_span<f64> samples) -> void {
+  //the state stays in registers for the whole block
+  f64 z1 = this->z1, z2 = this->z2;
+  f64* data = samples.data();
+  for(u32 n : range(samples.size())) {
+    f64 in = data[n];
+    f64 out = in * a0 + z1;
+    z1 = in * a1 + z2 - b1 * out;
+    z2 = in * a2 - b2 * out;
+    data[n] = out;
+  }
+  this->z1 = z1, this->z2 = z2;
+}
+
+inline auto Biquad::serialize(serializer& s) -> void {
+  s(z1);
+  s(z2);
+}
+
 //compute Q values for low-shelf and high-shelf filtering
 inline auto Biquad::shelf(f64 gain, f64 slope) -> f64 {
   f64 a = pow(10, gain / 40);
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <nall/serializer.hpp>
+
 //DC offset removal IIR filter
 
 namespace nall::DSP::IIR {
@@ -7,6 +9,8 @@ namespace nall::DSP::IIR {
 struct DCRemoval {
   auto reset() -> void;
   auto process(f64 in) -> f64;  //normalized sample (-1.0 to +1.0)
+  auto process(array_span<f64> samples) -> void;  //filters a block of samples in place
+  auto serialize(serializer&) -> void;
 
 private:
   f64 x;
@@ -24,4 +28,21 @@ inline auto DCRemoval::process(f64 in) -> f64 {
   return x;
 }
 
+inline auto DCRemoval::process(array_span<f64> samples) -> void {
+  f64 x = this->x, y = this->y;
+  f64* data = samples.data();
+  for(u32 n : range(samples.size())) {
+    f64 in = data[n];
+    x = 0.999 * x + in - y;
+    y = in;
+    data[n] = x;
+  }
+  this->x = x, this->y = y;
+}
+
+inline auto DCRemoval::serialize(serializer& s) -> void {
+  s(x);
+  s(y);
+}
+
 }
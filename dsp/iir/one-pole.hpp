@@ -1,5 +1,7 @@
 #pragma once
 
+#include <nall/serializer.hpp>
+
 //one-pole first-order IIR filter
 
 namespace nall::DSP::IIR {
@@ -12,6 +14,8 @@ struct OnePole {
 
   auto reset(Type type, f64 cutoffFrequency, f64 samplingFrequency) -> void;
   auto process(f64 in) -> f64;  //normalized sample (-1.0 to +1.0)
+  auto process(array_span<f64> samples) -> void;  //filters a block of samples in place
+  auto serialize(serializer&) -> void;
 
 private:
   Type type;
@@ -41,4 +45,15 @@ inline auto OnePole::process(f64 in) -> f64 {
   return z1 = in * a0 + z1 * b1;
 }
 
+inline auto OnePole::process(array_span<f64> samples) -> void {
+  f64 z1 = this->z1;
+  f64* data = samples.data();
+  for(u32 n : range(samples.size())) data[n] = z1 = data[n] * a0 + z1 * b1;
+  this->z1 = z1;
+}
+
+inline auto OnePole::serialize(serializer& s) -> void {
+  s(z1);
+}
+
 }
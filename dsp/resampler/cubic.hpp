@@ -80,4 +80,169 @@ inline auto Cubic::serialize(serializer& s) -> void {
   s(_samples);
 }
 
+//multi-channel cubic resampler operating on blocks of interleaved frames (f32 or f64)
+//the interpolation weights are computed once per output frame and shared by every channel,
+//and channels are processed several at a time with SIMD
+
+template<typename T>
+struct CubicFrames {
+  static_assert(is_same_v<T, f32> || is_same_v<T, f64>);
+
+  auto channels() const -> u32 { return _channels; }
+  auto inputFrequency() const -> f64 { return _inputFrequency; }
+  auto outputFrequency() const -> f64 { return _outputFrequency; }
+
+  auto reset(u32 channels, f64 inputFrequency, f64 outputFrequency = 0, u32 queueSize = 0) -> void;
+  auto setInputFrequency(f64 inputFrequency) -> void;
+  auto pending() const -> u32;                  //number of frames ready to be read
+  auto read(array_span<T> samples) -> u32;      //returns the number of frames read
+  auto write(array_view<T> samples) -> void;    //trailing partial frames are ignored
+  auto serialize(serializer&) -> void;
+
+private:
+  auto interpolate(T* output, const T* input, f64 mu) const -> void;
+
+  u32 _channels = 0;
+  f64 _inputFrequency;
+  f64 _outputFrequency;
+
+  f64 _ratio;
+  f64 _fraction;
+  vector<T> _history;  //the last three input frames, followed by the frames of the current write
+  vector<T> _samples;  //circular buffer of output frames
+  u32 _capacity = 0;   //in frames
+  u32 _read = 0;
+  u32 _size = 0;
+};
+
+template<typename T>
+inline auto CubicFrames<T>::reset(u32 channels, f64 inputFrequency, f64 outputFrequency, u32 queueSize) -> void {
+  _channels = max(1u, channels);
+  _inputFrequency = inputFrequency;
+  _outputFrequency = outputFrequency ? outputFrequency : _inputFrequency;
+
+  _ratio = _inputFrequency / _outputFrequency;
+  _fraction = 0.0;
+  _history.reset();
+  _history.resize(3 * _channels);
+  _capacity = max(1u, queueSize ? queueSize : (u32)(_outputFrequency * 0.02));  //default to 20ms max queue size
+  _samples.reset();
+  _samples.resize(_capacity * _channels);
+  _read = 0;
+  _size = 0;
+}
+
+template<typename T>
+inline auto CubicFrames<T>::setInputFrequency(f64 inputFrequency) -> void {
+  _inputFrequency = inputFrequency;
+  _ratio = _inputFrequency / _outputFrequency;
+}
+
+template<typename T>
+inline auto CubicFrames<T>::pending() const -> u32 {
+  return _size;
+}
+
+template<typename T>
+inline auto CubicFrames<T>::read(array_span<T> samples) -> u32 {
+  u32 frames = min(_size, (u32)samples.size() / max(1u, _channels));
+  u32 first = min(frames, _capacity - _read);
+  memcpy(samples.data(), _samples.data() + _read * _channels, first * _channels * sizeof(T));
+  memcpy(samples.data() + first * _channels, _samples.data(), (frames - first) * _channels * sizeof(T));
+  _read = (_read + frames) % _capacity;
+  _size -= frames;
+  return frames;
+}
+
+template<typename T>
+inline auto CubicFrames<T>::write(array_view<T> samples) -> void {
+  if(!_channels) return;
+  u32 frames = samples.size() / _channels;
+  _history.resize((3 + frames) * _channels);
+  memcpy(_history.data() + 3 * _channels, samples.data(), frames * _channels * sizeof(T));
+
+  auto& mu = _fraction;
+  const T* input = _history.data();
+  for(u32 frame : range(frames)) {
+    while(mu <= 1.0) {
+      //once full, the oldest frame is overwritten, as with queue<T>
+      if(_size == _capacity) _read = (_read + 1) % _capacity, _size--;
+      u32 slot = _read + _size++;
+      if(slot >= _capacity) slot -= _capacity;
+      interpolate(_samples.data() + slot * _channels, input, mu);
+      mu += _ratio;
+    }
+    mu -= 1.0;
+    input += _channels;
+  }
+
+  memmove(_history.data(), _history.data() + frames * _channels, 3 * _channels * sizeof(T));
+  _history.resize(3 * _channels);
+}
+
+template<typename T>
+inline auto CubicFrames<T>::interpolate(T* output, const T* input, f64 mu) const -> void {
+  //Cubic::write() expanded into one weight per history frame
+  T w0 = ((-mu + 2.0) * mu - 1.0) * mu;
+  T w1 = (( mu - 2.0) * mu) * mu + 1.0;
+  T w2 = ((-mu + 1.0) * mu + 1.0) * mu;
+  T w3 = (( mu - 1.0) * mu) * mu;
+
+  const u32 channels = _channels;
+  const T* s0 = input;
+  const T* s1 = s0 + channels;
+  const T* s2 = s1 + channels;
+  const T* s3 = s2 + channels;
+  u32 c = 0;
+
+  #if defined(__SSE2__)
+  if constexpr(is_same_v<T, f32>) {
+    __m128 v0 = _mm_set1_ps(w0), v1 = _mm_set1_ps(w1), v2 = _mm_set1_ps(w2), v3 = _mm_set1_ps(w3);
+    for(; c + 4 <= channels; c += 4) {
+      __m128 sum = _mm_mul_ps(_mm_loadu_ps(s0 + c), v0);
+      sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(s1 + c), v1));
+      sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(s2 + c), v2));
+      sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(s3 + c), v3));
+      _mm_storeu_ps(output + c, sum);
+    }
+    //stereo, and the remainder of wider layouts, go through the low half of a register
+    //two f32 samples are moved as one 64-bit integer lane: no f64 access to f32 data, and no alignment requirement
+    auto load2 = [](const f32* p) { return _mm_castsi128_ps(_mm_loadl_epi64((const __m128i*)p)); };
+    for(; c + 2 <= channels; c += 2) {
+      __m128 sum = _mm_mul_ps(load2(s0 + c), v0);
+      sum = _mm_add_ps(sum, _mm_mul_ps(load2(s1 + c), v1));
+      sum = _mm_add_ps(sum, _mm_mul_ps(load2(s2 + c), v2));
+      sum = _mm_add_ps(sum, _mm_mul_ps(load2(s3 + c), v3));
+      _mm_storel_epi64((__m128i*)(output + c), _mm_castps_si128(sum));
+    }
+  }
+  if constexpr(is_same_v<T, f64>) {
+    __m128d v0 = _mm_set1_pd(w0), v1 = _mm_set1_pd(w1), v2 = _mm_set1_pd(w2), v3 = _mm_set1_pd(w3);
+    for(; c + 2 <= channels; c += 2) {
+      __m128d sum = _mm_mul_pd(_mm_loadu_pd(s0 + c), v0);
+      sum = _mm_add_pd(sum, _mm_mul_pd(_mm_loadu_pd(s1 + c), v1));
+      sum = _mm_add_pd(sum, _mm_mul_pd(_mm_loadu_pd(s2 + c), v2));
+      sum = _mm_add_pd(sum, _mm_mul_pd(_mm_loadu_pd(s3 + c), v3));
+      _mm_storeu_pd(output + c, sum);
+    }
+  }
+  #endif
+
+  for(; c < channels; c++) {
+    output[c] = s0[c] * w0 + s1[c] * w1 + s2[c] * w2 + s3[c] * w3;
+  }
+}
+
+template<typename T>
+inline auto CubicFrames<T>::serialize(serializer& s) -> void {
+  s(_inputFrequency);
+  s(_outputFrequency);
+  s(_ratio);
+  s(_fraction);
+  s(array_span<T>{_history.data(), _history.size()});
+  s(array_span<T>{_samples.data(), _samples.size()});
+  s(_read);
+  s(_size);
+}
+
 }
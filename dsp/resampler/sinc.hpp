@@ -0,0 +1,210 @@
+#pragma once
+
+#include <nall/queue.hpp>
+#include <nall/serializer.hpp>
+
+//polyphase windowed-sinc resampler
+//unlike Cubic, this band-limits the input to the output Nyquist frequency, so it can downsample by large ratios without aliasing
+//the filter bank is designed for the ratio given to reset(); small changes through setInputFrequency() (dynamic rate control)
+//reuse it, and the fractional phase between two bank entries is linearly interpolated
+//larger changes redesign the bank mid-stream: the input history is kept, and the change in filter delay is absorbed,
+//so that the output continues without a gap or a jump
+
+namespace nall::DSP::Resampler {
+
+struct Sinc {
+  auto inputFrequency() const -> f64 { return _inputFrequency; }
+  auto outputFrequency() const -> f64 { return _outputFrequency; }
+
+  auto reset(f64 inputFrequency, f64 outputFrequency = 0, u32 queueSize = 0) -> void;
+  auto setInputFrequency(f64 inputFrequency) -> void;
+  auto pending() const -> bool;
+  auto read() -> f64;
+  auto write(f64 sample) -> void;
+  auto serialize(serializer&) -> void;
+
+private:
+  static constexpr u32 Taps = 32;  //filter length, in samples at the lower of the two rates
+  static constexpr f64 Rolloff = 0.90;  //passband edge, as a fraction of the lower Nyquist frequency
+  static constexpr f64 Beta = 8.0;  //Kaiser window shape
+
+  auto design(f64 ratio) -> void;
+  auto silence() -> void;
+  static auto dot(const f32* samples, const f32* coefficients, u32 length) -> f32;
+  static auto bessel(f64 x) -> f64;
+
+  f64 _inputFrequency;
+  f64 _outputFrequency;
+
+  f64 _ratio;
+  f64 _fraction;           //position of the next output past the newest filtered input; negative after the filter delay shrinks
+  f64 _designRatio = 0.0;  //ratio the filter bank was computed for
+  u32 _length = 0;         //filter length, in input samples
+  u32 _phases = 0;
+  vector<f32> _bank;       //_phases + 1 sets of _length coefficients
+  vector<f32> _history;    //input samples; the newest _length are filtered
+  u32 _offset = 0;         //one past the newest input sample
+  queue<f64> _samples;
+};
+
+inline auto Sinc::reset(f64 inputFrequency, f64 outputFrequency, u32 queueSize) -> void {
+  _inputFrequency = inputFrequency;
+  _outputFrequency = outputFrequency ? outputFrequency : _inputFrequency;
+
+  _ratio = _inputFrequency / _outputFrequency;
+  _fraction = 0.0;
+  design(_ratio);
+  silence();
+  _samples.resize(queueSize ? queueSize : _outputFrequency * 0.02);  //default to 20ms max queue size
+}
+
+inline auto Sinc::setInputFrequency(f64 inputFrequency) -> void {
+  _inputFrequency = inputFrequency;
+  _ratio = _inputFrequency / _outputFrequency;
+  //only redesign the bank when the cutoff has moved noticeably
+  if(fabs(_ratio / _designRatio - 1.0) <= 0.02) return;
+
+  //the filtered point lies _length / 2 samples behind the newest input: when the length changes,
+  //the output position is moved by the difference, so that no input is skipped or repeated.
+  //a negative position needs that many older samples in front of the window, so they are carried over as well;
+  //the position accumulates over redesigns without writes in between, and is bounded to what the history can hold
+  u32 length = _length;
+  design(_ratio);
+  _fraction += (s32)(_length / 2) - (s32)(length / 2);
+  _fraction = max(_fraction, -2.0 * _length);
+  u32 extra = max(0, -(s32)floor(_fraction));
+  u32 keep = min(_offset, _length - 1 + extra);
+  vector<f32> history;
+  history.resize(_length * 4 + 1024);
+  memcpy(history.data() + _length - 1 + extra - keep, _history.data() + _offset - keep, keep * sizeof(f32));
+  _history.reset();  //vector move assignment does not release the previous buffer
+  _history = move(history);
+  _offset = _length - 1 + extra;
+}
+
+inline auto Sinc::pending() const -> bool {
+  return _samples.pending();
+}
+
+inline auto Sinc::read() -> f64 {
+  return _samples.read();
+}
+
+inline auto Sinc::write(f64 sample) -> void {
+  if(_offset == _history.size()) {
+    //keep the newest samples and continue writing after them
+    memmove(_history.data(), _history.data() + _offset - (_length - 1), (_length - 1) * sizeof(f32));
+    _offset = _length - 1;
+  }
+  _history[_offset++] = sample;
+
+  auto& mu = _fraction;
+  const f32* window = _history.data() + _offset - _length;
+  while(mu <= 1.0) {
+    //mu is only negative right after the filter delay shrank: those outputs are filtered from older windows
+    s32 whole = mu < 0.0 ? (s32)floor(mu) : 0;
+    const f32* samples = window + whole;
+    f64 position = (mu - whole) * _phases;
+    u32 phase = min((u32)position, _phases - 1);
+    f64 x = position - phase;
+    const f32* coefficients = _bank.data() + phase * _length;
+    f32 a = dot(samples, coefficients, _length);
+    f32 b = dot(samples, coefficients + _length, _length);
+    _samples.write(a + (b - a) * x);
+    mu += _ratio;
+  }
+
+  mu -= 1.0;
+}
+
+inline auto Sinc::serialize(serializer& s) -> void {
+  s(_inputFrequency);
+  s(_outputFrequency);
+  s(_ratio);
+  s(_fraction);
+  f64 designRatio = _designRatio;
+  s(designRatio);
+  if(s.reading() && designRatio != _designRatio) design(designRatio), silence();
+  s(array_span<f32>{_history.data(), _history.size()});
+  s(_offset);
+  s(_samples);
+}
+
+inline auto Sinc::design(f64 ratio) -> void {
+  //when downsampling, the kernel is stretched to move the cutoff down to the output Nyquist frequency;
+  //the stretched kernel is smoother per input sample, so fewer phases are needed to keep the bank small
+  f64 factor = max(1.0, ratio);
+  f64 cutoff = Rolloff / factor;
+  _designRatio = ratio;
+  _length = ((u32)ceil(Taps * factor) + 3) & ~3;
+  _phases = max(16u, 256u / (u32)ceil(factor));
+
+  _bank.reset();
+  _bank.resize((_phases + 1) * _length);
+  f64 center = _length / 2 - 1;
+  f64 window = bessel(Beta);
+  for(u32 phase : range(_phases + 1)) {
+    f32* coefficients = _bank.data() + phase * _length;
+    f64 delay = (f64)phase / _phases;
+    f64 total = 0.0;
+    for(u32 tap : range(_length)) {
+      //the filtered point lies delay samples past the center tap
+      f64 t = tap - center - delay;
+      f64 w = t / (_length / 2);
+      f64 value = 0.0;
+      if(fabs(w) < 1.0) {
+        f64 x = Math::Pi * cutoff * t;
+        value = (x == 0.0 ? 1.0 : sin(x) / x) * bessel(Beta * sqrt(1.0 - w * w)) / window;
+      }
+      coefficients[tap] = value;
+      total += value;
+    }
+    //normalize every phase to unity gain at DC
+    for(u32 tap : range(_length)) coefficients[tap] /= total;
+  }
+}
+
+inline auto Sinc::silence() -> void {
+  _history.reset();
+  _history.resize(_length * 4 + 1024);
+  _offset = _length - 1;
+}
+
+inline auto Sinc::dot(const f32* samples, const f32* coefficients, u32 length) -> f32 {
+  //length is always a multiple of four
+  #if defined(__SSE2__)
+  __m128 sum0 = _mm_setzero_ps();
+  __m128 sum1 = _mm_setzero_ps();
+  u32 n = 0;
+  for(; n + 8 <= length; n += 8) {
+    sum0 = _mm_add_ps(sum0, _mm_mul_ps(_mm_loadu_ps(samples + n + 0), _mm_loadu_ps(coefficients + n + 0)));
+    sum1 = _mm_add_ps(sum1, _mm_mul_ps(_mm_loadu_ps(samples + n + 4), _mm_loadu_ps(coefficients + n + 4)));
+  }
+  if(n < length) {
+    sum0 = _mm_add_ps(sum0, _mm_mul_ps(_mm_loadu_ps(samples + n), _mm_loadu_ps(coefficients + n)));
+  }
+  __m128 sum = _mm_add_ps(sum0, sum1);
+  sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+  sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+  return _mm_cvtss_f32(sum);
+  #else
+  f32 sum[4] = {};
+  for(u32 n = 0; n < length; n += 4) {
+    for(u32 lane : range(4)) sum[lane] += samples[n + lane] * coefficients[n + lane];
+  }
+  return (sum[0] + sum[2]) + (sum[1] + sum[3]);
+  #endif
+}
+
+//zeroth-order modified Bessel function of the first kind, for the Kaiser window
+inline auto Sinc::bessel(f64 x) -> f64 {
+  f64 sum = 1.0, term = 1.0;
+  for(u32 k = 1; k < 32; k++) {
+    term *= (x / (2.0 * k)) * (x / (2.0 * k));
+    sum += term;
+    if(term < sum * 1e-12) break;
+  }
+  return sum;
+}
+
+}
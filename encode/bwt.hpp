@@ -30,53 +30,64 @@ namespace nall::Encode {
   Thus, suffix sorting gives us "nlal" as the last column instead of "nall".
   This is because BWT rotates the input string, whereas suffix arrays sort the input string.
 
-  Adding a 256th character terminator before sorting will not produce the desired result, either.
-  A more complicated string such as "mississippi" will sort as "ssmppissiii" with terminator=256,
-  and as "ipssmpissii" with terminator=0, alphabet=1..256, whereas we want "pssmipissii".
-
-  Performing a merge sort to use a specialized comparison function that wraps suffixes is too slow at O(n log n).
-
-  Producing a custom induced sort to handle rotations would be incredibly complicated,
-  owing to the recursive nature of induced sorting, among other things.
-
-  So instead, a temporary array is produced that contains the input suffix twice.
-  This is then fed into the suffix array sort, and the doubled matches are filtered out.
-  After this point, suffixes are sorted in their mirrored form, and the correct result can be derived
-
-  The result of this is an O(2n) algorithm, which vastly outperforms a naive O(n log n) algorithm,
-  but is still far from ideal. However, this will have to do until a better solution is devised.
-
-  Although to be fair, BWT is inferior to the bijective BWT anyway, so it may not be worth the effort.
+  However, rotations and suffixes do sort identically when the string is a Lyndon word:
+  a string that is strictly smaller than all of its rotations, such as "alln" above.
+  A proper suffix of a Lyndon word is never also a prefix of it, so a comparison of two rotations
+  is always decided before either suffix runs out.
+
+  The smallest rotation of any string is a Lyndon word u repeated k times (k > 1 for periodic strings).
+  Its sorted rotations are those of u, each repeated k times in a row.
+  So the transform only needs to suffix sort u, rather than the input string written out twice.
 */
 
 inline auto BWT(array_view<u8> input) -> vector<u8> {
-  auto size = input.size();
+  u32 size = input.size();
   vector<u8> output;
-  output.reserve(8 + 8 + size);
-  for(u32 byte : range(8)) output.append(size >> byte * 8);
-  for(u32 byte : range(8)) output.append(0x00);
-
-  vector<u8> buffer;
-  buffer.reserve(2 * size);
-  for(u32 offset : range(size)) buffer.append(input[offset]);
-  for(u32 offset : range(size)) buffer.append(input[offset]);
-
-  auto suffixes = SuffixArray(buffer);
+  output.resize(8 + 8 + size);
+  for(u32 byte : range(8)) output[byte] = (u64)size >> byte * 8;
+  if(size == 0) return output;
+
+  //find the smallest rotation, in O(n) time and O(1) space
+  u32 i = 0, j = 1, k = 0;
+  while(i < size && j < size && k < size) {
+    u8 x = input[(i + k) % size];
+    u8 y = input[(j + k) % size];
+    if(x == y) { k++; continue; }
+    if(x > y) i += k + 1; else j += k + 1;
+    if(i == j) j++;
+    k = 0;
+  }
+  u32 start = min(i, j);
+  auto rotated = [&](u32 offset) -> u8 {
+    offset += start;
+    return input[offset < size ? offset : offset - size];
+  };
+
+  //the first Lyndon factor of the smallest rotation is its period (Duval)
+  u32 a = 0, b = 1;
+  while(b < size && rotated(a) <= rotated(b)) {
+    if(rotated(a) < rotated(b)) a = 0; else a++;
+    b++;
+  }
+  u32 period = b - a;
+  if(size % period) period = size;  //cannot happen for the smallest rotation; but remain safe
 
-  vector<s32> prefixes;
-  prefixes.reserve(size);
+  vector<u8> lyndon;
+  lyndon.resize(period);
+  for(u32 offset : range(period)) lyndon[offset] = rotated(offset);
+  u32 repeats = size / period;
 
-  for(u32 offset : range(2 * size + 1)) {
-    u32 suffix = suffixes[offset];
-    if(suffix >= size) continue;  //beyond the bounds of the original input string
-    prefixes.append(suffix);
-  }
+  auto suffixes = suffix_array(lyndon);
 
+  //rotation 0 of the input is rotation (size - start) of the smallest rotation
+  u32 origin = (size - start) % period;
   u64 root = 0;
-  for(u32 offset : range(size)) {
-    u32 suffix = prefixes[offset];
-    if(suffix == 0) root = offset, suffix = size;
-    output.append(input[--suffix]);
+  u8* target = output.data() + 16;
+  for(u32 rank : range(1, period + 1)) {
+    u32 suffix = suffixes[rank];
+    if(suffix == origin) root = (rank - 1) * repeats + repeats - 1;
+    u8 last = lyndon[suffix ? suffix - 1 : period - 1];
+    for(u32 repeat : range(repeats)) *target++ = last;
   }
   for(u32 byte : range(8)) output[8 + byte] = root >> byte * 8;
 
@@ -15,20 +15,35 @@ inline auto Huffman(array_view<u8> input) -> vector<u8> {
   array<Node[512]> nodes;
   for(u32 offset : range(input.size())) nodes[input[offset]].frequency++;
 
+  //candidate nodes are kept in a binary min-heap, ordered by frequency and then by index
+  u32 heap[512], heapSize = 0;
+  auto less = [&](u32 x, u32 y) {
+    if(nodes[x].frequency != nodes[y].frequency) return nodes[x].frequency < nodes[y].frequency;
+    return x < y;
+  };
+  auto push = [&](u32 index) {
+    u32 n = heapSize++;
+    while(n && less(index, heap[n - 1 >> 1])) heap[n] = heap[n - 1 >> 1], n = n - 1 >> 1;
+    heap[n] = index;
+  };
+
   u32 count = 0;
   for(u32 offset : range(511)) {
-    if(nodes[offset].frequency) count++;
+    if(nodes[offset].frequency) count++, push(offset);
     else nodes[offset].parent = 511;
   }
 
   auto minimum = [&] {
-    u32 frequency = ~0, minimum = 511;
-    for(u32 index : range(511)) {
-      if(!nodes[index].parent && nodes[index].frequency && nodes[index].frequency < frequency) {
-        frequency = nodes[index].frequency;
-        minimum = index;
-      }
+    if(!heapSize) return 511u;
+    u32 minimum = heap[0], last = heap[--heapSize], n = 0;
+    while(true) {
+      u32 child = n * 2 + 1;
+      if(child >= heapSize) break;
+      if(child + 1 < heapSize && less(heap[child + 1], heap[child])) child++;
+      if(!less(heap[child], last)) break;
+      heap[n] = heap[child], n = child;
     }
+    heap[n] = last;
     return minimum;
   };
 
@@ -44,39 +59,56 @@ inline auto Huffman(array_view<u8> input) -> vector<u8> {
     nodes[index].rhs = rhs;
     nodes[index].parent = 0;
     nodes[index].frequency = nodes[lhs].frequency + nodes[rhs].frequency;
+    if(index != 511) push(index);
     index++;
   }
 
-  u32 byte = 0, bits = 0;
-  auto write = [&](bool bit) {
-    byte = byte << 1 | bit;
-    if(++bits == 8) output.append(byte), bits = 0;
+  //bits are gathered in a 64-bit accumulator, most significant first
+  u64 buffer = 0;
+  u32 bits = 0;
+  auto write = [&](u64 code, u32 length) {
+    buffer = buffer << length | code;
+    bits += length;
+    while(bits >= 8) output.append(buffer >> (bits -= 8));
   };
 
   //only the upper half of the table is needed for decompression
   //the first 256 nodes are always treated as leaf nodes
   for(u32 offset : range(256)) {
-    for(u32 index : reverse(range(9))) write(nodes[256 + offset].lhs >> index & 1);
-    for(u32 index : reverse(range(9))) write(nodes[256 + offset].rhs >> index & 1);
+    write(nodes[256 + offset].lhs, 9);
+    write(nodes[256 + offset].rhs, 9);
   }
 
-  for(u32 byte : input) {
-    u32 node = byte, length = 0;
+  //codes are found once per symbol: traversing the array produces the bitstream in reverse order
+  //codes longer than 56 bits can only occur with very skewed inputs, and are written out a bit at a time
+  struct Code {
+    u64 bits = 0;
+    u32 length = 0;
     u256 sequence = 0;
-    //traversing the array produces the bitstream in reverse order
+  } codes[256];
+  for(u32 symbol : range(256)) {
+    if(!nodes[symbol].frequency) continue;
+    auto& code = codes[symbol];
+    u32 node = symbol;
     do {
       u32 parent = nodes[node].parent;
       bool bit = nodes[nodes[node].parent].rhs == node;
-      sequence = sequence << 1 | bit;
-      length++;
+      code.sequence = code.sequence << 1 | bit;
+      code.length++;
       node = parent;
     } while(node != 511);
-    //output the generated bits in the correct order
-    for(u32 index : range(length)) {
-      write(sequence >> index & 1);
+    for(u32 index : range(min(code.length, 56u))) code.bits = code.bits << 1 | (u64)(code.sequence >> index & 1);
+  }
+
+  for(u32 byte : input) {
+    auto& code = codes[byte];
+    if(code.length <= 56) {
+      write(code.bits, code.length);
+    } else {
+      for(u32 index : range(code.length)) write((u64)(code.sequence >> index & 1), 1);
     }
   }
-  while(bits) write(0);
+  if(bits) write(0, 8 - bits);
 
   return output;
 }
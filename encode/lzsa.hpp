@@ -1,5 +1,7 @@
 #pragma once
 
+#include <nall/hash-chain.hpp>
+#include <nall/parallel.hpp>
 #include <nall/suffix-array.hpp>
 #include <nall/encode/bwt.hpp>
 #include <nall/encode/huffman.hpp>
@@ -8,12 +10,14 @@
 
 namespace nall::Encode {
 
-inline auto LZSA(array_view<u8> input) -> vector<u8> {
+//encodes input[start, input.size()) as one stream; matches may refer back into the dictionary input[0, start)
+//finder provides previous(length, offset, address) over the whole of input, as SuffixArray::lpf() and HashChain do
+template<typename Finder>
+inline auto LZSA(array_view<u8> input, u32 start, Finder& finder) -> vector<u8> {
   vector<u8> output;
-  for(u32 byte : range(8)) output.append(input.size() >> byte * 8);
+  for(u32 byte : range(8)) output.append(input.size() - start >> byte * 8);
 
-  auto suffixArray = SuffixArray(input).lpf();
-  u32 index = 0;
+  u32 index = start;
   vector<u8> flags;
   vector<u8> literals;
   vector<u8> stringLengths;
@@ -47,11 +51,11 @@ inline auto LZSA(array_view<u8> input) -> vector<u8> {
 
   while(index < input.size()) {
     s32 length, offset;
-    suffixArray.previous(length, offset, index);
+    finder.previous(length, offset, index);
 
 /*  for(u32 ahead = 1; ahead <= 2; ahead++) {
       s32 aheadLength, aheadOffset;
-      suffixArray.previous(aheadLength, aheadOffset, index + ahead);
+      finder.previous(aheadLength, aheadOffset, index + ahead);
       if(aheadLength > length && aheadOffset >= 0) {
         length = 0;
         break;
@@ -83,4 +87,38 @@ inline auto LZSA(array_view<u8> input) -> vector<u8> {
   return output;
 }
 
+inline auto LZSA(array_view<u8> input) -> vector<u8> {
+  auto suffixArray = SuffixArray(input).lpf();
+  return LZSA(input, 0, suffixArray);
+}
+
+//block mode: the input is split into blocks that are compressed in parallel, with hash chains rather than a suffix array
+//with dictionary set, matches in each block may also refer back into the block before it, at the cost of decoding in order
+//header: size | 1 << 63 (8 bytes), blockSize (4 bytes), dictionary (1 byte), then each block as a stream length (8 bytes) and stream
+inline auto LZSA(array_view<u8> input, u32 blockSize, bool dictionary = true, u32 threads = 0) -> vector<u8> {
+  blockSize = max(1u, blockSize);
+  u32 blocks = (input.size() + blockSize - 1) / blockSize;
+  vector<vector<u8>> streams;
+  for(u32 block : range(blocks)) streams.append(vector<u8>{});  //resize() would copy an allocated empty vector into each
+
+  parallel::run(blocks, [&](u32 block) {
+    u64 start = (u64)block * blockSize;
+    u64 end = min<u64>(input.size(), start + blockSize);
+    u64 origin = dictionary ? start - min<u64>(start, blockSize) : start;
+    HashChain hashChain({input.data() + origin, end - origin}, 6);
+    streams[block] = LZSA({input.data() + origin, end - origin}, start - origin, hashChain);
+  }, threads);
+
+  vector<u8> output;
+  for(u32 byte : range(8)) output.append(((u64)input.size() | 1ull << 63) >> byte * 8);
+  for(u32 byte : range(4)) output.append(blockSize >> byte * 8);
+  output.append(dictionary);
+  for(auto& stream : streams) {
+    for(u32 byte : range(8)) output.append((u64)stream.size() >> byte * 8);
+    output.append(stream);
+    stream.reset();
+  }
+  return output;
+}
+
 }
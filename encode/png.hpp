@@ -3,83 +3,140 @@
 #include <nall/file.hpp>
 #include <nall/run.hpp>
 #include <nall/string.hpp>
+#include <nall/hash/adler32.hpp>
+#include <nall/hash/crc32.hpp>
 
 namespace nall::Encode {
 
-//this encodes an array of pixels into an uncompressed PNG image file.
-//if optipng or pngcrush are installed, the resulting PNG file will be quickly compressed.
+//this encodes an array of pixels into an uncompressed PNG image.
+//if optipng or pngcrush are installed, PNG files written to disk will be quickly compressed.
 //if nall gains a deflate implementation one day, then this can be improved to offer integrated compression.
 
+//pixels are 32-bit ARGB values; pitch is in bytes
+
 struct PNG {
   static auto RGB8 (const string& filename, const void* data, u32 pitch, u32 width, u32 height) -> bool;
   static auto RGBA8(const string& filename, const void* data, u32 pitch, u32 width, u32 height) -> bool;
 
+  //encode to memory, rather than to a file
+  static auto RGB8 (const void* data, u32 pitch, u32 width, u32 height) -> vector<u8>;
+  static auto RGBA8(const void* data, u32 pitch, u32 width, u32 height) -> vector<u8>;
+
 private:
-  auto compress(const string& filename) -> bool;
-  auto open(const string& filename) -> bool;
-  auto close() -> void;
-  auto header() -> void;
-  auto footer() -> void;
-  auto information(u32 width, u32 height, u32 depth, u32 type) -> void;
-  auto dataHeader(u32 width, u32 height, u32 bitsPerPixel) -> void;
-  auto dataLine(bool lastLine) -> void;
-  auto dataFooter() -> void;
-  auto write(u8 data) -> void;
-  auto adler(u8 data) -> void;
-
-  file_buffer fp;
-  Hash::CRC32 crc32;
-  u16 adler1 = 1;
-  u16 adler2 = 0;
-  u16 bytesPerLine = 0;
+  static auto create(const void* data, u32 pitch, u32 width, u32 height, bool alpha) -> vector<u8>;
+  static auto save(const string& filename, const vector<u8>& png) -> bool;
+  static auto compress(const string& filename) -> bool;
 };
 
 inline auto PNG::RGB8(const string& filename, const void* data, u32 pitch, u32 width, u32 height) -> bool {
-  PNG png;
-  if(!png.open(filename)) return false;
-
-  png.header();
-  png.information(width, height, 8, 2);
-  png.dataHeader(width, height, 24);
-  for(u32 y : range(height)) {
-    const auto input = (const u32*)data + y * (pitch >> 2);
-    png.dataLine(y == height - 1);
-    for(u32 x : range(width)) {
-      auto pixel = input[x];   //RGB
-      png.adler(pixel >> 16);  //R
-      png.adler(pixel >>  8);  //G
-      png.adler(pixel >>  0);  //B
-    }
-  }
-  png.dataFooter();
-  png.footer();
-  png.close();
-  png.compress(filename);
-  return true;
+  return save(filename, create(data, pitch, width, height, false));
 }
 
 inline auto PNG::RGBA8(const string& filename, const void* data, u32 pitch, u32 width, u32 height) -> bool {
-  PNG png;
-  if(!png.open(filename)) return false;
+  return save(filename, create(data, pitch, width, height, true));
+}
+
+inline auto PNG::RGB8(const void* data, u32 pitch, u32 width, u32 height) -> vector<u8> {
+  return create(data, pitch, width, height, false);
+}
 
-  png.header();
-  png.information(width, height, 8, 6);
-  png.dataHeader(width, height, 32);
+inline auto PNG::RGBA8(const void* data, u32 pitch, u32 width, u32 height) -> vector<u8> {
+  return create(data, pitch, width, height, true);
+}
+
+inline auto PNG::create(const void* data, u32 pitch, u32 width, u32 height, bool alpha) -> vector<u8> {
+  //each scanline is a filter type byte (0 = none), then the pixels in R,G,B(,A) order;
+  //the zlib stream stores them in uncompressed deflate blocks, split where a scanline exceeds the block limit
+  static constexpr u32 BlockLimit = 65535;
+  u32 bytesPerLine = 1 + width * (alpha ? 4 : 3);
+  u32 blocksPerLine = (bytesPerLine + BlockLimit - 1) / BlockLimit;
+  u32 idatSize = 2 + height * (5 * blocksPerLine + bytesPerLine) + 4;
+
+  vector<u8> png;
+  png.resize(8 + 25 + 12 + idatSize + 12);
+  u8* p = png.data();
+
+  auto write8  = [&](u8 value) { *p++ = value; };
+  auto write16 = [&](u16 value) { write8(value >> 0); write8(value >> 8); };
+  auto write32 = [&](u32 value) { write8(value >> 24); write8(value >> 16); write8(value >> 8); write8(value >> 0); };
+  auto chunk = [&](const char* fourCC, u32 length) -> u8* {
+    write32(length);
+    u8* start = p;
+    memcpy(p, fourCC, 4), p += 4;
+    return start;
+  };
+  auto checksum = [&](const u8* start) {
+    write32(Hash::CRC32({start, (u64)(p - start)}).value());
+  };
+
+  for(u8 byte : {0x89, 0x50, 0x4e, 0x47, 0x0d, 0x0a, 0x1a, 0x0a}) write8(byte);  //\x89PNG\r\n\x1a\n
+
+  u8* ihdr = chunk("IHDR", 13);
+  write32(width);
+  write32(height);
+  write8(8);              //bit depth
+  write8(alpha ? 6 : 2);  //color type
+  write8(0x00);           //no compression
+  write8(0x00);           //no filter
+  write8(0x00);           //no interlace
+  checksum(ihdr);
+
+  u8* idat = chunk("IDAT", idatSize);
+  write8(0x78);
+  write8(0xda);
+
+  Hash::Adler32 adler;
+  vector<u8> line;
+  line.resize(bytesPerLine);
   for(u32 y : range(height)) {
-    const auto input = (const u32*)data + y * (pitch >> 2);
-    png.dataLine(y == height - 1);
-    for(u32 x : range(width)) {
-      auto pixel = input[x];   //ARGB
-      png.adler(pixel >> 16);  //R
-      png.adler(pixel >>  8);  //G
-      png.adler(pixel >>  0);  //B
-      png.adler(pixel >> 24);  //A
+    auto input = (const u32*)((const u8*)data + y * pitch);
+    u8* output = line.data();
+    *output++ = 0x00;  //no filter
+    u32 x = 0;
+    #if defined(__SSE2__)
+    if(alpha) {
+      //A,R,G,B in a little-endian u32 is stored as B,G,R,A: exchange the first and third bytes
+      const __m128i keep = _mm_set1_epi32(0xff00ff00);
+      const __m128i low = _mm_set1_epi32(0x000000ff);
+      for(; x + 4 <= width; x += 4, output += 16) {
+        __m128i pixels = _mm_loadu_si128((const __m128i*)(input + x));
+        __m128i result = _mm_and_si128(pixels, keep);
+        result = _mm_or_si128(result, _mm_and_si128(_mm_srli_epi32(pixels, 16), low));
+        result = _mm_or_si128(result, _mm_slli_epi32(_mm_and_si128(pixels, low), 16));
+        _mm_storeu_si128((__m128i*)output, result);
+      }
+    }
+    #endif
+    for(; x < width; x++) {
+      u32 pixel = input[x];
+      *output++ = pixel >> 16;  //R
+      *output++ = pixel >>  8;  //G
+      *output++ = pixel >>  0;  //B
+      if(alpha) *output++ = pixel >> 24;  //A
+    }
+    adler.input(line);
+
+    for(u32 offset = 0; offset < bytesPerLine; offset += BlockLimit) {
+      u32 length = min(BlockLimit, bytesPerLine - offset);
+      write8(y == height - 1 && offset + length == bytesPerLine);  //final block
+      write16(length);
+      write16(~length);
+      memcpy(p, line.data() + offset, length), p += length;
     }
   }
-  png.dataFooter();
-  png.footer();
-  png.close();
-  png.compress(filename);
+
+  write32(adler.value());
+  checksum(idat);
+
+  u8* iend = chunk("IEND", 0);
+  checksum(iend);
+
+  return png;
+}
+
+inline auto PNG::save(const string& filename, const vector<u8>& png) -> bool {
+  if(!file::write(filename, png)) return false;
+  compress(filename);
   return true;
 }
 
@@ -92,98 +149,4 @@ inline auto PNG::compress(const string& filename) -> bool {
   return false;
 }
 
-inline auto PNG::open(const string& filename) -> bool {
-  fp = file::open(filename, file::mode::write);
-  return (bool)fp;
-}
-
-inline auto PNG::close() -> void {
-  fp.close();
-}
-
-inline auto PNG::header() -> void {
-  fp.write(0x89);
-  fp.write('P');
-  fp.write('N');
-  fp.write('G');
-  fp.write(0x0d);
-  fp.write(0x0a);
-  fp.write(0x1a);
-  fp.write(0x0a);
-}
-
-inline auto PNG::footer() -> void {
-  fp.writem(0, 4L);
-  crc32.reset();
-  write('I');
-  write('E');
-  write('N');
-  write('D');
-  fp.writem(crc32.value(), 4L);
-}
-
-inline auto PNG::information(u32 width, u32 height, u32 depth, u32 type) -> void {
-  fp.writem(13, 4L);
-  crc32.reset();
-  write('I');
-  write('H');
-  write('D');
-  write('R');
-  write(width  >> 24);
-  write(width  >> 16);
-  write(width  >>  8);
-  write(width  >>  0);
-  write(height >> 24);
-  write(height >> 16);
-  write(height >>  8);
-  write(height >>  0);
-  write(depth);
-  write(type);
-  write(0x00);  //no compression
-  write(0x00);  //no filter
-  write(0x00);  //no interlace
-  fp.writem(crc32.value(), 4L);
-}
-
-inline auto PNG::dataHeader(u32 width, u32 height, u32 bitsPerPixel) -> void {
-  bytesPerLine = 1 + width * (bitsPerPixel / 8);
-  u32 idatSize = 2 + height * (5 + bytesPerLine) + 4;
-  fp.writem(idatSize, 4L);
-  crc32.reset();
-  write('I');
-  write('D');
-  write('A');
-  write('T');
-  write(0x78);
-  write(0xda);
-}
-
-inline auto PNG::dataLine(bool lastLine) -> void {
-  write(lastLine);
-  write( bytesPerLine >> 0);
-  write( bytesPerLine >> 8);
-  write(~bytesPerLine >> 0);
-  write(~bytesPerLine >> 8);
-  adler(0x00);  //no filter
-}
-
-inline auto PNG::dataFooter() -> void {
-  write(adler2 >> 8);
-  write(adler2 >> 0);
-  write(adler1 >> 8);
-  write(adler1 >> 0);
-  fp.writem(crc32.value(), 4L);
-}
-
-inline auto PNG::write(u8 data) -> void {
-  fp.write(data);
-  crc32.input(data);
-}
-
-inline auto PNG::adler(u8 data) -> void {
-  write(data);
-  adler1 = (adler1 + data  ) % 65521;
-  adler2 = (adler2 + adler1) % 65521;
-}
-
 }
@@ -0,0 +1,438 @@
+#pragma once
+
+//asynchronous file reader: queue many pread-style requests, then collect their completions
+//on Linux, requests are submitted through io_uring when the kernel permits it
+//everywhere else (or when io_uring is unavailable), a small thread pool services the queue
+
+#include <nall/platform.hpp>
+#include <nall/array-span.hpp>
+#include <nall/string.hpp>
+#include <nall/thread.hpp>
+#include <nall/vector.hpp>
+
+#include <condition_variable>
+
+#if defined(PLATFORM_LINUX) && __has_include(<linux/io_uring.h>)
+  #include <linux/io_uring.h>
+  #include <sys/syscall.h>
+#endif
+
+namespace nall {
+
+struct file_async {
+  struct completion {
+    u64 tag = 0;
+    s64 result = 0;  //bytes read, or -errno on failure
+  };
+
+  static constexpr u32 DefaultDepth = 32;
+
+  file_async(const file_async&) = delete;
+  auto operator=(const file_async&) -> file_async& = delete;
+
+  file_async() = default;
+  file_async(const string& filename, u32 depth = DefaultDepth) { open(filename, depth); }
+  ~file_async() { close(); }
+
+  explicit operator bool() const { return _open; }
+  auto size() const -> u64 { return _size; }
+  auto depth() const -> u32 { return _requests.size(); }
+  auto pending() const -> u32 { return _pending; }
+  auto uring() const -> bool { return _uring.fd >= 0; }
+
+  auto open(const string& filename, u32 depth = DefaultDepth) -> bool;
+  auto close() -> void;
+
+  //queues a read of target.size() bytes starting at offset
+  //blocks while the queue is full; completions reaped meanwhile are returned by the next wait()
+  auto submit(u64 offset, array_span<u8> target, u64 tag = 0) -> void;
+
+  //returns all available completions; blocks until there is at least one if any are outstanding
+  auto wait() -> vector<completion>;
+
+  //waits for every outstanding request; returns false if any read failed or came up short
+  auto flush() -> bool;
+
+private:
+  struct request {
+    u64 offset = 0;
+    u8* target = nullptr;
+    u64 length = 0;
+    u64 done = 0;
+    u64 tag = 0;
+    #if defined(PLATFORM_LINUX) && __has_include(<linux/io_uring.h>)
+    struct iovec iovec = {};
+    #endif
+  };
+
+  auto _read(request& r) -> s64;
+  auto _retire(u32 slot, s64 result) -> void;
+  auto _reap(bool block) -> void;
+  #if defined(PLATFORM_LINUX) && __has_include(<linux/io_uring.h>)
+  auto _complete() -> void;
+  auto _submit() -> void;
+  #endif
+
+  bool _open = false;
+  u64 _size = 0;
+  bool _failed = false;
+  u32 _pending = 0;
+  vector<request> _requests;
+  vector<u32> _free;
+  vector<completion> _completed;
+
+  #if defined(API_WINDOWS)
+  HANDLE _handle = INVALID_HANDLE_VALUE;
+  #else
+  s32 _fd = -1;
+  #endif
+
+  struct uring {
+    s32 fd = -1;
+    #if defined(PLATFORM_LINUX) && __has_include(<linux/io_uring.h>)
+    auto setup(u32 entries) -> bool;
+    auto reset() -> void;
+    auto push(u32 slot, s32 file, request& r) -> void;
+    auto unpush() -> u32;
+    auto enter(u32 submit, u32 minimum) -> s32;
+    auto completed() const -> bool;
+
+    u32 queued = 0;  //entries pushed to the submission queue that the kernel has not yet accepted
+
+    void* sqRing = nullptr;
+    void* cqRing = nullptr;
+    u64 sqRingSize = 0;
+    u64 cqRingSize = 0;
+    io_uring_sqe* sqes = nullptr;
+    u64 sqesSize = 0;
+    u32* sqTail = nullptr;
+    u32* sqMask = nullptr;
+    u32* sqArray = nullptr;
+    u32* cqHead = nullptr;
+    u32* cqTail = nullptr;
+    u32* cqMask = nullptr;
+    io_uring_cqe* cqes = nullptr;
+    #endif
+  } _uring;
+
+  struct pool {
+    u32 workers = 0;
+    vector<u32> queued;
+    vector<completion> finished;  //tag holds the request slot
+    std::mutex lock;
+    std::condition_variable requested;
+    std::condition_variable completed;
+    bool stopping = false;
+  } _pool;
+};
+
+#if defined(PLATFORM_LINUX) && __has_include(<linux/io_uring.h>)
+
+inline auto file_async::uring::setup(u32 entries) -> bool {
+  io_uring_params params = {};
+  fd = syscall(__NR_io_uring_setup, entries, &params);
+  if(fd < 0) return fd = -1, false;
+
+  sqRingSize = params.sq_off.array + params.sq_entries * sizeof(u32);
+  cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+  if(params.features & IORING_FEAT_SINGLE_MMAP) sqRingSize = cqRingSize = max(sqRingSize, cqRingSize);
+
+  sqRing = mmap(nullptr, sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+  if(sqRing == MAP_FAILED) return sqRing = nullptr, reset(), false;
+  if(params.features & IORING_FEAT_SINGLE_MMAP) {
+    cqRing = sqRing;
+  } else {
+    cqRing = mmap(nullptr, cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+    if(cqRing == MAP_FAILED) return cqRing = nullptr, reset(), false;
+  }
+
+  sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+  sqes = (io_uring_sqe*)mmap(nullptr, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+  if(sqes == MAP_FAILED) return sqes = nullptr, reset(), false;
+
+  sqTail  = (u32*)((u8*)sqRing + params.sq_off.tail);
+  sqMask  = (u32*)((u8*)sqRing + params.sq_off.ring_mask);
+  sqArray = (u32*)((u8*)sqRing + params.sq_off.array);
+  cqHead  = (u32*)((u8*)cqRing + params.cq_off.head);
+  cqTail  = (u32*)((u8*)cqRing + params.cq_off.tail);
+  cqMask  = (u32*)((u8*)cqRing + params.cq_off.ring_mask);
+  cqes    = (io_uring_cqe*)((u8*)cqRing + params.cq_off.cqes);
+  return true;
+}
+
+inline auto file_async::uring::reset() -> void {
+  if(sqes) munmap(sqes, sqesSize);
+  if(cqRing && cqRing != sqRing) munmap(cqRing, cqRingSize);
+  if(sqRing) munmap(sqRing, sqRingSize);
+  if(fd >= 0) ::close(fd);
+  *this = {};
+}
+
+inline auto file_async::uring::push(u32 slot, s32 file, request& r) -> void {
+  //IORING_OP_READV is used over IORING_OP_READ as it is available from the first io_uring kernels (5.1)
+  r.iovec.iov_base = r.target + r.done;
+  r.iovec.iov_len = r.length - r.done;
+
+  u32 tail = *sqTail;
+  u32 index = tail & *sqMask;
+  auto& sqe = sqes[index];
+  memset(&sqe, 0, sizeof(io_uring_sqe));
+  sqe.opcode = IORING_OP_READV;
+  sqe.fd = file;
+  sqe.off = r.offset + r.done;
+  sqe.addr = (u64)&r.iovec;
+  sqe.len = 1;
+  sqe.user_data = slot;
+  sqArray[index] = index;
+  __atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE);
+  queued++;
+}
+
+//takes back the most recently pushed entry that the kernel has not accepted; returns its slot
+//without SQPOLL, the kernel only reads the submission queue during io_uring_enter, so the tail can safely be rewound
+inline auto file_async::uring::unpush() -> u32 {
+  u32 tail = *sqTail - 1;
+  u32 slot = sqes[tail & *sqMask].user_data;
+  __atomic_store_n(sqTail, tail, __ATOMIC_RELEASE);
+  queued--;
+  return slot;
+}
+
+//returns the number of entries submitted, or -errno
+inline auto file_async::uring::enter(u32 submit, u32 minimum) -> s32 {
+  while(true) {
+    s32 result = syscall(__NR_io_uring_enter, fd, submit, minimum, minimum ? IORING_ENTER_GETEVENTS : 0, nullptr, 0);
+    if(result >= 0) return result;
+    if(errno != EINTR) return -errno;
+  }
+}
+
+inline auto file_async::uring::completed() const -> bool {
+  return *cqHead != __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+}
+
+#endif
+
+inline auto file_async::open(const string& filename, u32 depth) -> bool {
+  close();
+  depth = bit::round(max(1u, depth));
+
+  #if defined(API_WINDOWS)
+  _handle = CreateFileW(utf16_t(filename), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if(_handle == INVALID_HANDLE_VALUE) return false;
+  LARGE_INTEGER size;
+  GetFileSizeEx(_handle, &size);
+  _size = size.QuadPart;
+  #else
+  _fd = ::open(filename, O_RDONLY);
+  if(_fd < 0) return false;
+  struct stat data;
+  fstat(_fd, &data);
+  _size = data.st_size;
+  #endif
+
+  _requests.resize(depth);
+  for(u32 slot : reverse(range(depth))) _free.append(slot);
+
+  #if defined(PLATFORM_LINUX) && __has_include(<linux/io_uring.h>)
+  if(_uring.setup(depth)) return _open = true;
+  #endif
+
+  //thread pool fallback: reads beyond a handful in flight rarely improve throughput
+  //workers are detached; close() waits for each of them to check out instead of joining
+  _pool.stopping = false;
+  _pool.workers = min(depth, 4u);
+  for(u32 n : range(_pool.workers)) {
+    thread::create([&](uintptr) {
+      thread::detach();
+      std::unique_lock<std::mutex> guard{_pool.lock};
+      while(true) {
+        _pool.requested.wait(guard, [&] { return _pool.stopping || _pool.queued; });
+        if(!_pool.queued) break;
+        u32 slot = _pool.queued.takeFirst();
+        guard.unlock();
+        s64 result = _read(_requests[slot]);
+        guard.lock();
+        _pool.finished.append({slot, result});
+        _pool.completed.notify_all();
+      }
+      _pool.workers--;
+      _pool.completed.notify_all();
+    });
+  }
+  return _open = true;
+}
+
+inline auto file_async::close() -> void {
+  if(_pending) flush();
+
+  if(_pool.workers) {
+    std::unique_lock<std::mutex> guard{_pool.lock};
+    _pool.stopping = true;
+    _pool.requested.notify_all();
+    _pool.completed.wait(guard, [&] { return _pool.workers == 0; });
+  }
+
+  #if defined(PLATFORM_LINUX) && __has_include(<linux/io_uring.h>)
+  if(_uring.fd >= 0) _uring.reset();
+  #endif
+
+  #if defined(API_WINDOWS)
+  if(_handle != INVALID_HANDLE_VALUE) CloseHandle(_handle), _handle = INVALID_HANDLE_VALUE;
+  #else
+  if(_fd >= 0) ::close(_fd), _fd = -1;
+  #endif
+
+  _requests.reset();
+  _free.reset();
+  _completed.reset();
+  _failed = false;
+  _pending = 0;
+  _size = 0;
+  _open = false;
+}
+
+inline auto file_async::submit(u64 offset, array_span<u8> target, u64 tag) -> void {
+  if(!_open) return _completed.append({tag, -EBADF});
+  while(!_free) _reap(true);
+
+  u32 slot = _free.takeLast();
+  auto& r = _requests[slot];
+  r.offset = offset;
+  r.target = target.data();
+  r.length = target.size();
+  r.done = 0;
+  r.tag = tag;
+  _pending++;
+
+  #if defined(PLATFORM_LINUX) && __has_include(<linux/io_uring.h>)
+  if(_uring.fd >= 0) {
+    _uring.push(slot, _fd, r);
+    return _submit();
+  }
+  #endif
+
+  {
+    lock_guard<std::mutex> guard{_pool.lock};
+    _pool.queued.append(slot);
+  }
+  _pool.requested.notify_one();
+}
+
+inline auto file_async::wait() -> vector<completion> {
+  if(!_completed && _pending) _reap(true);
+  _reap(false);
+  return move(_completed);
+}
+
+inline auto file_async::flush() -> bool {
+  while(_pending) _reap(true);
+  _completed.reset();
+  bool result = !_failed;
+  _failed = false;
+  return result;
+}
+
+//synchronous read used by the thread pool; loops until the request is satisfied or the file ends
+inline auto file_async::_read(request& r) -> s64 {
+  while(r.done < r.length) {
+    #if defined(API_WINDOWS)
+    OVERLAPPED overlapped = {};
+    u64 offset = r.offset + r.done;
+    overlapped.Offset = (DWORD)offset;
+    overlapped.OffsetHigh = (DWORD)(offset >> 32);
+    DWORD length = 0;
+    DWORD request = (DWORD)min(r.length - r.done, (u64)1 << 30);
+    if(!ReadFile(_handle, r.target + r.done, request, &length, &overlapped)) {
+      if(GetLastError() == ERROR_HANDLE_EOF) break;
+      return -EIO;
+    }
+    #else
+    ssize_t length = pread(_fd, r.target + r.done, r.length - r.done, r.offset + r.done);
+    if(length < 0 && errno == EINTR) continue;
+    if(length < 0) return -errno;
+    #endif
+    if(length == 0) break;
+    r.done += length;
+  }
+  return r.done;
+}
+
+inline auto file_async::_retire(u32 slot, s64 result) -> void {
+  auto& r = _requests[slot];
+  if(result < 0 || (u64)result < r.length) _failed = true;
+  _completed.append({r.tag, result});
+  _free.append(slot);
+  _pending--;
+}
+
+inline auto file_async::_reap(bool block) -> void {
+  if(!_pending) return;
+
+  #if defined(PLATFORM_LINUX) && __has_include(<linux/io_uring.h>)
+  if(_uring.fd >= 0) {
+    if(block && !_uring.completed()) _uring.enter(0, 1);
+    _complete();
+    _submit();
+    return;
+  }
+  #endif
+
+  std::unique_lock<std::mutex> guard{_pool.lock};
+  if(block) _pool.completed.wait(guard, [&] { return (bool)_pool.finished; });
+  for(auto& [slot, result] : _pool.finished) _retire(slot, result);
+  _pool.finished.reset();
+}
+
+#if defined(PLATFORM_LINUX) && __has_include(<linux/io_uring.h>)
+
+//retires every available completion; short reads are pushed again, to be sent by the next _submit()
+inline auto file_async::_complete() -> void {
+  u32 head = *_uring.cqHead;
+  while(head != __atomic_load_n(_uring.cqTail, __ATOMIC_ACQUIRE)) {
+    auto& cqe = _uring.cqes[head++ & *_uring.cqMask];
+    u32 slot = cqe.user_data;
+    auto& r = _requests[slot];
+    if(cqe.res > 0) r.done += cqe.res;
+    if(cqe.res < 0 && cqe.res != -EAGAIN && cqe.res != -EINTR) {
+      _retire(slot, cqe.res);
+    } else if(cqe.res == 0 || r.done >= r.length) {
+      _retire(slot, r.done);
+    } else {
+      //short read: queue the remainder
+      _uring.push(slot, _fd, r);
+    }
+  }
+  __atomic_store_n(_uring.cqHead, head, __ATOMIC_RELEASE);
+}
+
+//hands every queued entry to the kernel, so that none are left counted as pending but never sent
+//when the kernel is short of resources (EAGAIN) or the completion queue is full (EBUSY),
+//completions are reaped to make room and the submission is retried; once nothing else is in flight to wait for,
+//the remaining requests are read synchronously instead. any other error fails the remaining requests
+inline auto file_async::_submit() -> void {
+  while(_uring.queued) {
+    s32 result = _uring.enter(_uring.queued, 0);
+    if(result > 0) {
+      _uring.queued -= min((u32)result, _uring.queued);
+      continue;
+    }
+
+    bool busy = result == 0 || result == -EAGAIN || result == -EBUSY;
+    if(busy && _pending > _uring.queued) {
+      if(_uring.completed() || _uring.enter(0, 1) >= 0) {
+        _complete();
+        continue;
+      }
+    }
+
+    while(_uring.queued) {
+      u32 slot = _uring.unpush();
+      _retire(slot, busy ? _read(_requests[slot]) : (s64)result);
+    }
+  }
+}
+
+#endif
+
+}
@@ -18,6 +18,7 @@ namespace nall {
 //on all other OSes, FILE* is buffered
 //in order to ensure good performance, file_buffer implements its own buffer
 //this speeds up Windows substantially, without harming performance elsewhere much
+//bulk transfers larger than the buffer bypass it and go straight to fread/fwrite
 
 struct file_buffer {
   struct mode  { enum : u32 { read, write, modify, append }; };
@@ -26,15 +27,22 @@ struct file_buffer {
   file_buffer(const file_buffer&) = delete;
   auto operator=(const file_buffer&) -> file_buffer& = delete;
 
+  static constexpr u32 DefaultBufferSize = 64 * 1024;
+
   file_buffer() = default;
-  file_buffer(const string& filename, u32 mode) { open(filename, mode); }
+  file_buffer(const string& filename, u32 mode, u32 bufferSize = DefaultBufferSize) {
+    setBufferSize(bufferSize);
+    open(filename, mode);
+  }
 
   file_buffer(file_buffer&& source) { operator=(move(source)); }
 
   ~file_buffer() { close(); }
 
   auto operator=(file_buffer&& source) -> file_buffer& {
-    buffer = source.buffer;
+    close();
+
+    buffer = move(source.buffer);
     bufferOffset = source.bufferOffset;
     bufferDirty = source.bufferDirty;
     fileHandle = source.fileHandle;
@@ -60,7 +68,7 @@ struct file_buffer {
     if(!fileHandle) return 0;             //file not open
     if(fileOffset >= fileSize) return 0;  //cannot read past end of file
     bufferSynchronize();
-    return buffer[fileOffset++ & buffer.size() - 1];
+    return buffer[fileOffset++ & bufferMask()];
   }
 
   template<typename T = u64> auto readl(u32 length = 1) -> T {
@@ -83,19 +91,47 @@ struct file_buffer {
   auto reads(u64 length) -> string {
     string result;
     result.resize(length);
-    for(auto& byte : result) byte = read();
+    read({result.get(), length});
     return result;
   }
 
   auto read(array_span<u8> memory) -> void {
-    for(auto& byte : memory) byte = read();
+    u8* target = memory.data();
+    u64 length = memory.size();
+    u64 available = fileHandle && fileOffset < fileSize ? min(length, fileSize - fileOffset) : 0;
+    length -= available;
+
+    while(available) {
+      //aligned transfers of at least one full buffer are read directly into the target
+      if((fileOffset & bufferMask()) == 0 && available >= buffer.size() && bufferOffset != (s64)fileOffset) {
+        u64 direct = available & ~bufferMask();
+        bufferFlush();
+        fseek(fileHandle, fileOffset, SEEK_SET);
+        (void)fread(target, 1, direct, fileHandle);
+        target += direct;
+        fileOffset += direct;
+        available -= direct;
+        continue;
+      }
+
+      bufferSynchronize();
+      u64 index = fileOffset & bufferMask();
+      u64 chunk = min(available, buffer.size() - index);
+      memcpy(target, buffer.data() + index, chunk);
+      target += chunk;
+      fileOffset += chunk;
+      available -= chunk;
+    }
+
+    //cannot read past end of file
+    if(length) memset(target, 0, length);
   }
 
   auto write(u8 data) -> void {
     if(!fileHandle) return;             //file not open
     if(fileMode == mode::read) return;  //writes not permitted
     bufferSynchronize();
-    buffer[fileOffset++ & buffer.size() - 1] = data;
+    buffer[fileOffset++ & bufferMask()] = data;
     bufferDirty = true;
     if(fileOffset > fileSize) fileSize = fileOffset;
   }
@@ -114,16 +150,45 @@ struct file_buffer {
   }
 
   auto writes(const string& s) -> void {
-    for(auto& byte : s) write(byte);
+    write({s.data(), s.size()});
   }
 
   auto write(array_view<u8> memory) -> void {
-    for(auto& byte : memory) write(byte);
+    if(!fileHandle) return;             //file not open
+    if(fileMode == mode::read) return;  //writes not permitted
+    const u8* source = memory.data();
+    u64 length = memory.size();
+
+    while(length) {
+      //aligned transfers of at least one full buffer are written directly from the source
+      if((fileOffset & bufferMask()) == 0 && length >= buffer.size()) {
+        u64 direct = length & ~bufferMask();
+        bufferFlush();
+        bufferOffset = -1LL;  //buffered contents may be overwritten below
+        fseek(fileHandle, fileOffset, SEEK_SET);
+        (void)fwrite(source, 1, direct, fileHandle);
+        source += direct;
+        fileOffset += direct;
+        length -= direct;
+        if(fileOffset > fileSize) fileSize = fileOffset;
+        continue;
+      }
+
+      bufferSynchronize();
+      u64 index = fileOffset & bufferMask();
+      u64 chunk = min(length, buffer.size() - index);
+      memcpy(buffer.data() + index, source, chunk);
+      bufferDirty = true;
+      source += chunk;
+      fileOffset += chunk;
+      length -= chunk;
+      if(fileOffset > fileSize) fileSize = fileOffset;
+    }
   }
 
   template<typename... P> auto print(P&&... p) -> void {
     string s{forward<P>(p)...};
-    for(auto& byte : s) write(byte);
+    writes(s);
   }
 
   auto flush() -> void {
@@ -154,6 +219,17 @@ struct file_buffer {
     fileOffset = seekOffset;
   }
 
+  //size is rounded up to a power of two; larger buffers favor sequential access
+  auto setBufferSize(u32 size) -> void {
+    bufferFlush();
+    bufferOffset = -1LL;
+    buffer.resize(bit::round(max(4096u, size)));
+  }
+
+  auto bufferSize() const -> u32 {
+    return buffer.size();
+  }
+
   auto offset() const -> u64 {
     if(!fileHandle) return 0;
     return fileOffset;
@@ -195,6 +271,7 @@ struct file_buffer {
     #endif
     }
     if(!fileHandle) return false;
+    if(!buffer) setBufferSize(DefaultBufferSize);
 
     bufferOffset = -1LL;
     fileOffset = 0;
@@ -212,7 +289,7 @@ struct file_buffer {
   }
 
 private:
-  array<u8[4096]> buffer;
+  vector<u8> buffer;
   s64 bufferOffset = -1LL;
   bool bufferDirty = false;
   FILE* fileHandle = nullptr;
@@ -220,14 +297,18 @@ private:
   u64 fileSize = 0;
   u32 fileMode = mode::read;
 
+  auto bufferMask() const -> u64 {
+    return buffer.size() - 1;
+  }
+
   auto bufferSynchronize() -> void {
     if(!fileHandle) return;
-    if(bufferOffset == (fileOffset & ~(buffer.size() - 1))) return;
+    if(bufferOffset == (fileOffset & ~bufferMask())) return;
 
     bufferFlush();
-    bufferOffset = fileOffset & ~(buffer.size() - 1);
+    bufferOffset = fileOffset & ~bufferMask();
     fseek(fileHandle, bufferOffset, SEEK_SET);
-    u64 length = bufferOffset + buffer.size() <= fileSize ? buffer.size() : fileSize & buffer.size() - 1;
+    u64 length = bufferOffset + buffer.size() <= fileSize ? buffer.size() : fileSize & bufferMask();
     if(length) (void)fread(buffer.data(), 1, length, fileHandle);
   }
 
@@ -238,7 +319,7 @@ private:
     if(!bufferDirty) return;            //buffer unmodified since read
 
     fseek(fileHandle, bufferOffset, SEEK_SET);
-    u64 length = bufferOffset + buffer.size() <= fileSize ? buffer.size() : fileSize & buffer.size() - 1;
+    u64 length = bufferOffset + buffer.size() <= fileSize ? buffer.size() : fileSize & bufferMask();
     if(length) (void)fwrite(buffer.data(), 1, length, fileHandle);
     bufferOffset = -1LL;
     bufferDirty = false;
@@ -24,6 +24,7 @@ namespace nall {
 
 struct file_map {
   struct mode { enum : u32 { read, write, modify, append }; };
+  struct advice { enum : u32 { normal, sequential, random, willneed, dontneed, hugepage }; };
 
   file_map(const file_map&) = delete;
   auto operator=(const file_map&) = delete;
@@ -39,6 +40,41 @@ struct file_map {
   auto data() -> u8* { return _data; }
   auto data() const -> const u8* { return _data; }
 
+  //hints the expected access pattern of (part of) the mapping to the operating system
+  //returns false when the hint is unsupported; this is never an error
+  auto advise(u32 hint, u64 offset = 0, u64 length = ~0ull) -> bool {
+    if(offset >= _size) return false;
+    return advise(_data + offset, min(length, _size - offset), hint);
+  }
+
+  //also usable on any page-backed memory, such as large heap allocations
+  //the range is shrunk inward to page boundaries
+  //note that dontneed discards the contents of private (heap or copy-on-write) pages: they read back as zeroes
+  static auto advise(const void* data, u64 size, u32 hint) -> bool {
+    #if defined(API_POSIX)
+    s32 flag = -1;
+    switch(hint) {
+    case advice::normal:     flag = MADV_NORMAL;     break;
+    case advice::sequential: flag = MADV_SEQUENTIAL; break;
+    case advice::random:     flag = MADV_RANDOM;     break;
+    case advice::willneed:   flag = MADV_WILLNEED;   break;
+    case advice::dontneed:   flag = MADV_DONTNEED;   break;
+    #if defined(MADV_HUGEPAGE)
+    case advice::hugepage:   flag = MADV_HUGEPAGE;   break;
+    #endif
+    }
+    if(flag < 0) return false;
+
+    uintptr page = sysconf(_SC_PAGESIZE);
+    uintptr lo = ((uintptr)data + page - 1) & ~(page - 1);
+    uintptr hi = ((uintptr)data + size) & ~(page - 1);
+    if(lo >= hi) return false;
+    return madvise((void*)lo, hi - lo, flag) == 0;
+    #else
+    return false;
+    #endif
+  }
+
 //auto operator=(file_map&& source) -> file_map&;
 //auto open(const string& filename, u32 mode) -> bool;
 //auto close() -> void;
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <nall/file-async.hpp>
 #include <nall/file-buffer.hpp>
 
 namespace nall {
@@ -18,7 +19,13 @@ struct file : inode {
     if(sourcename == targetname) return true;
     if(auto reader = file::open(sourcename, mode::read)) {
       if(auto writer = file::open(targetname, mode::write)) {
-        for(u64 n : range(reader.size())) writer.write(reader.read());
+        vector<u8> buffer;
+        buffer.resize(min(reader.size(), (u64)4 * 1024 * 1024));
+        for(u64 offset = 0; offset < reader.size(); offset += buffer.size()) {
+          array_span<u8> span{buffer.data(), min((u64)buffer.size(), reader.size() - offset)};
+          reader.read(span);
+          writer.write(span);
+        }
         return true;
       }
     }
@@ -80,6 +87,20 @@ struct file : inode {
     return memory;
   }
 
+  //issues up to depth concurrent block reads; returns an empty vector if any read fails
+  static auto read(const string& filename, u32 depth) -> vector<u8> {
+    static constexpr u64 BlockSize = 1024 * 1024;
+    vector<u8> memory;
+    if(file_async fp{filename, depth}) {
+      memory.resize(fp.size());
+      for(u64 offset = 0; offset < memory.size(); offset += BlockSize) {
+        fp.submit(offset, {memory.data() + offset, min(BlockSize, memory.size() - offset)});
+      }
+      if(!fp.flush()) memory.reset();
+    }
+    return memory;
+  }
+
   static auto read(const string& filename, array_span<u8> memory) -> bool {
     if(auto fp = file::open(filename, mode::read)) return fp.read(memory), true;
     return false;
@@ -0,0 +1,119 @@
+#pragma once
+
+//longest previous match search using hash chains
+//a lighter alternative to SuffixArray::lpf() for large inputs: it needs four bytes per input byte plus a table of up to one more,
+//and each search visits at most `depth` earlier positions sharing the same leading bytes, so the longest match may be missed
+
+namespace nall {
+
+struct HashChain {
+  using type = HashChain;
+
+  //matches shorter than minimum (3 to 8 bytes) are never reported
+  HashChain(array_view<u8> input, u32 minimum = 4, u32 depth = 64) : input(input), minimum(minimum), depth(depth) {
+    //the table grows with the input (one entry per four bytes) so that chains stay short when the whole input is indexed
+    while(bits < 24 && 4ull << bits < input.size()) bits++;
+    heads.resize(1 << bits);
+    heads.fill(Nil);
+    chain.resize(input.size());
+  }
+
+  //same results as SuffixArray::previous(), but addresses must be queried in increasing order
+  //positions that were skipped over are still indexed, so matches can refer back to them
+  auto previous(s32& length, s32& offset, s32 address) -> void {
+    length = 0, offset = -1;
+    while(inserted < (u32)address) insert(inserted++);
+    u32 size = input.size();
+    if(address + minimum > size) return;
+
+    u32 longest = 0;
+    u32 limit = size - address;
+    u32 candidate = heads[hash(address)];
+    for(u32 step = 0; step < depth && candidate != Nil; step++, candidate = chain[candidate]) {
+      //a candidate can only be longer if it also matches at the current length
+      if(longest && input[candidate + longest] != input[address + longest]) continue;
+      u32 matched = compare(input.data() + candidate, input.data() + address, limit);
+      if(matched > longest) {
+        longest = matched, offset = candidate;
+        if(matched == limit) break;
+      }
+    }
+    if(longest < minimum) offset = -1;
+    else length = longest;
+    insert(inserted++);
+  }
+
+  //indexes every position, after which find() may be called from several threads at once
+  auto index() -> type& {
+    while(inserted < input.size()) insert(inserted++);
+    return *this;
+  }
+
+  //longest match for the start of data anywhere in the indexed part of input
+  auto find(s32& length, s32& offset, array_view<u8> data) const -> void {
+    length = 0, offset = -1;
+    if(data.size() < minimum) return;
+
+    u32 longest = 0;
+    u32 candidate = heads[hash(data.data())];
+    for(u32 step = 0; step < depth && candidate != Nil; step++, candidate = chain[candidate]) {
+      u32 limit = min<u64>(data.size(), input.size() - candidate);
+      if(limit <= longest || (longest && input[candidate + longest] != data[longest])) continue;
+      u32 matched = compare(input.data() + candidate, data.data(), limit);
+      if(matched > longest) {
+        longest = matched, offset = candidate;
+        if(matched == data.size()) break;
+      }
+    }
+    if(longest < minimum) offset = -1;
+    else length = longest;
+  }
+
+private:
+  static constexpr u32 Nil = ~0u;
+
+  auto load(const u8* data, u32 bytes) const -> u64 {
+    u64 value = 0;
+    for(u32 n : range(bytes)) value |= (u64)data[n] << n * 8;
+    return value;
+  }
+
+  auto hash(const u8* data) const -> u32 {
+    return load(data, minimum) * 0x9e3779b97f4a7c15ull >> (64 - bits);
+  }
+
+  auto hash(u32 address) const -> u32 {
+    return hash(input.data() + address);
+  }
+
+  auto insert(u32 address) -> void {
+    if(address + minimum > input.size()) return;
+    u32& head = heads[hash(address)];
+    chain[address] = head;
+    head = address;
+  }
+
+  //compares eight bytes at a time, then finds the mismatch within the last eight
+  auto compare(const u8* x, const u8* y, u32 limit) const -> u32 {
+    u32 length = 0;
+    while(length + 8 <= limit) {
+      u64 a, b;
+      memcpy(&a, x + length, 8);
+      memcpy(&b, y + length, 8);
+      if(a != b) break;
+      length += 8;
+    }
+    while(length < limit && x[length] == y[length]) length++;
+    return length;
+  }
+
+  array_view<u8> input;
+  u32 minimum;
+  u32 depth;
+  u32 bits = 16;
+  u32 inserted = 0;
+  vector<u32> heads;
+  vector<u32> chain;  //previous position with the same hash
+};
+
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <nall/hash/hash.hpp>
+
+namespace nall::Hash {
+
+//the checksum of zlib streams
+struct Adler32 : Hash {
+  using Hash::input;
+
+  Adler32(array_view<u8> buffer = {}) {
+    reset();
+    input(buffer);
+  }
+
+  auto reset() -> void override {
+    sumA = 1;
+    sumB = 0;
+  }
+
+  auto input(u8 value) -> void override {
+    sumA = (sumA + value) % Base;
+    sumB = (sumB + sumA) % Base;
+  }
+
+  //bulk input: the modulo is deferred for up to Block bytes, the most that cannot overflow 32-bit sums
+  auto input(const void* data, u64 size) -> void {
+    auto p = (const u8*)data;
+    u32 a = sumA, b = sumB;
+    while(size) {
+      u32 length = min<u64>(size, Block);
+      size -= length;
+      u32 x = 0;
+      #if defined(__SSE2__)
+      //per 16 bytes: a gains their sum, and b gains 16 * a plus the bytes weighted 16, 15, ..., 1
+      const __m128i zero = _mm_setzero_si128();
+      const __m128i weightsLo = _mm_setr_epi16(16, 15, 14, 13, 12, 11, 10, 9);
+      const __m128i weightsHi = _mm_setr_epi16( 8,  7,  6,  5,  4,  3,  2, 1);
+      __m128i vectorA = zero, vectorB = zero, prefix = zero;
+      u32 blocks = length / 16;
+      b += a * blocks * 16;
+      for(; x + 16 <= length; x += 16) {
+        __m128i bytes = _mm_loadu_si128((const __m128i*)(p + x));
+        prefix = _mm_add_epi32(prefix, vectorA);
+        vectorA = _mm_add_epi32(vectorA, _mm_sad_epu8(bytes, zero));
+        vectorB = _mm_add_epi32(vectorB, _mm_madd_epi16(_mm_unpacklo_epi8(bytes, zero), weightsLo));
+        vectorB = _mm_add_epi32(vectorB, _mm_madd_epi16(_mm_unpackhi_epi8(bytes, zero), weightsHi));
+      }
+      vectorB = _mm_add_epi32(vectorB, _mm_slli_epi32(prefix, 4));
+      a += sum(vectorA);
+      b += sum(vectorB);
+      #endif
+      for(; x < length; x++) {
+        a += p[x];
+        b += a;
+      }
+      a %= Base;
+      b %= Base;
+      p += length;
+    }
+    sumA = a, sumB = b;
+  }
+
+  auto input(array_view<u8> data) -> void {
+    input(data.data(), data.size());
+  }
+
+  auto input(const vector<u8>& data) -> void {
+    input(data.data(), data.size());
+  }
+
+  auto output() const -> vector<u8> override {
+    vector<u8> result;
+    for(auto n : reverse(range(4))) result.append(value() >> n * 8);
+    return result;
+  }
+
+  auto value() const -> u32 {
+    return sumB << 16 | sumA;
+  }
+
+private:
+  static constexpr u32 Base = 65521;
+  static constexpr u32 Block = 5552;
+
+  #if defined(__SSE2__)
+  static auto sum(__m128i value) -> u32 {
+    value = _mm_add_epi32(value, _mm_shuffle_epi32(value, 0x4e));
+    value = _mm_add_epi32(value, _mm_shuffle_epi32(value, 0xb1));
+    return _mm_cvtsi128_si32(value);
+  }
+  #endif
+
+  u32 sumA = 1;
+  u32 sumB = 0;
+};
+
+}
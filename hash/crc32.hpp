@@ -17,7 +17,32 @@ struct CRC32 : Hash {
   }
 
   auto input(u8 value) -> void override {
-    checksum = (checksum >> 8) ^ table(checksum ^ value);
+    checksum = (checksum >> 8) ^ tables()[0][(u8)(checksum ^ value)];
+  }
+
+  //bulk input: slice-by-8 consumes eight bytes per step through eight lookup tables
+  auto input(const void* data, u64 size) -> void {
+    auto p = (const u8*)data;
+    auto& table = tables();
+    u32 crc = checksum;
+    for(; size >= 8; size -= 8, p += 8) {
+      u32 one = crc ^ (p[0] << 0 | p[1] << 8 | p[2] << 16 | (u32)p[3] << 24);
+      u32 two = p[4] << 0 | p[5] << 8 | p[6] << 16 | (u32)p[7] << 24;
+      crc = table[7][(u8)(one >>  0)] ^ table[6][(u8)(one >>  8)]
+          ^ table[5][(u8)(one >> 16)] ^ table[4][(u8)(one >> 24)]
+          ^ table[3][(u8)(two >>  0)] ^ table[2][(u8)(two >>  8)]
+          ^ table[1][(u8)(two >> 16)] ^ table[0][(u8)(two >> 24)];
+    }
+    while(size--) crc = (crc >> 8) ^ table[0][(u8)(crc ^ *p++)];
+    checksum = crc;
+  }
+
+  auto input(array_view<u8> data) -> void {
+    input(data.data(), data.size());
+  }
+
+  auto input(const vector<u8>& data) -> void {
+    input(data.data(), data.size());
   }
 
   auto output() const -> vector<u8> override {
@@ -31,22 +56,27 @@ struct CRC32 : Hash {
   }
 
 private:
-  static auto table(u8 index) -> u32 {
-    static u32 table[256] = {};
-    static bool initialized = false;
-
-    if(!initialized) {
-      initialized = true;
-      for(auto index : range(256)) {
-        u32 crc = index;
-        for(auto bit : range(8)) {
-          crc = (crc >> 1) ^ (crc & 1 ? 0xedb8'8320 : 0);
+  //table[0] is the classic byte-at-a-time table; table[n] advances a byte through n further zero bytes
+  static auto tables() -> const u32 (&)[8][256] {
+    struct Tables {
+      Tables() {
+        for(auto index : range(256)) {
+          u32 crc = index;
+          for(auto bit : range(8)) {
+            crc = (crc >> 1) ^ (crc & 1 ? 0xedb8'8320 : 0);
+          }
+          table[0][index] = crc;
+        }
+        for(auto index : range(256)) {
+          for(auto slice : range(1, 8)) {
+            table[slice][index] = (table[slice - 1][index] >> 8) ^ table[0][(u8)table[slice - 1][index]];
+          }
         }
-        table[index] = crc;
       }
-    }
-
-    return table[index];
+      u32 table[8][256];
+    };
+    static const Tables instance;
+    return instance.table;
   }
 
   u32 checksum = 0;
@@ -4,9 +4,12 @@
 
 #include <nall/file-map.hpp>
 #include <nall/interpolation.hpp>
+#include <nall/parallel.hpp>
 #include <nall/stdint.hpp>
 #include <nall/decode/bmp.hpp>
 #include <nall/decode/png.hpp>
+#include <nall/encode/bmp.hpp>
+#include <nall/encode/png.hpp>
 
 namespace nall {
 
@@ -19,6 +22,14 @@ struct image {
     targetColor,  //color = targetColor
   };
 
+  enum class filter : u32 {
+    nearest,
+    linear,   //(bi)linear interpolation between the nearest source pixels
+    area,     //box filter: each output pixel averages the source area it covers
+    cubic,    //Catmull-Rom spline
+    lanczos,  //three-lobed Lanczos window
+  };
+
   struct channel {
     channel(u64 mask, u32 depth, u32 shift) : _mask(mask), _depth(depth), _shift(shift) {
     }
@@ -82,6 +93,9 @@ struct image {
   //scale.hpp
   auto scale(u32 width, u32 height, bool linear = true) -> void;
 
+  //resample.hpp
+  auto scale(u32 width, u32 height, filter mode) -> void;
+
   //blend.hpp
   auto impose(blend mode, u32 targetX, u32 targetY, image source, u32 x, u32 y, u32 width, u32 height) -> void;
 
@@ -93,6 +107,14 @@ struct image {
   auto transform(const image& source = {}) -> void;
   auto transform(bool endian, u32 depth, u64 alphaMask, u64 redMask, u64 greenMask, u64 blueMask) -> void;
 
+  //encode.hpp
+  auto encodePNG() const -> vector<u8>;
+  auto encodeBMP() const -> vector<u8>;
+
+  //parallel.hpp
+  static auto setThreads(u32 threads) -> void;
+  static auto threads() -> u32;
+
   //static.hpp
   static auto bitDepth(u64 color) -> u32;
   static auto bitShift(u64 color) -> u32;
@@ -117,15 +139,43 @@ struct image {
   auto blue() const { return _blue; }
 
 private:
+  //pixel.hpp
+  struct Generic;
+  template<u32 Depth, u64 AlphaMask, u64 RedMask, u64 GreenMask, u64 BlueMask> struct Packed;
+  using ARGB8888 = Packed<32, 255u << 24, 255u << 16, 255u <<  8, 255u <<  0>;
+  using ABGR8888 = Packed<32, 255u << 24, 255u <<  0, 255u <<  8, 255u << 16>;
+  using RGB565   = Packed<16, 0, 31u << 11, 63u << 5, 31u << 0>;
+  template<typename F> auto dispatch(F&& callback) const -> void;
+
+  //kernel.hpp
+  static auto alphaMultiply8888(u8* data, u32 width) -> void;
+  static auto impose8888(blend mode, u8* target, const u8* source, u32 width) -> void;
+  static auto swap8888(u8* target, const u8* source, u32 width) -> void;
+  static auto pack565(u8* target, const u8* source, u32 width) -> void;
+  static auto unpack565(u8* target, const u8* source, u32 width) -> void;
+  static auto interpolate8888(u32 a, u32 b, u32 x) -> u32;
+  static auto resampleWidth8888(u8* target, const u8* source, u32 width, const u32* first, const s16* weights, u32 taps) -> void;
+  static auto resampleHeight8888(u8* target, const u8* source, u32 pitch, u32 width, const s16* weights, u32 taps) -> void;
+
   //core.hpp
   auto allocate(u32 width, u32 height, u32 stride) -> u8*;
 
+  //parallel.hpp
+  static auto concurrency() -> atomic<u32>&;
+  template<typename F> static auto bands(u32 rows, u32 pitch, u64 work, const F& callback) -> void;
+
   //scale.hpp
   auto scaleLinearWidth(u32 width) -> void;
   auto scaleLinearHeight(u32 height) -> void;
   auto scaleLinear(u32 width, u32 height) -> void;
   auto scaleNearest(u32 width, u32 height) -> void;
 
+  //resample.hpp
+  struct Weights;
+  static auto resampleWeights(filter mode, u32 input, u32 output) -> Weights;
+  auto resampleWidth(u32 width, const Weights& weights) -> void;
+  auto resampleHeight(u32 height, const Weights& weights) -> void;
+
   //load.hpp
   auto loadBMP(const string& filename) -> bool;
   auto loadBMP(const u8* data, u32 size) -> bool;
@@ -133,16 +183,14 @@ private:
   auto loadPNG(const u8* data, u32 size) -> bool;
 
   //interpolation.hpp
-  auto isplit(u64* component, u64 color) -> void;
-  auto imerge(const u64* component) -> u64;
-  auto interpolate1f(u64 a, u64 b, f64 x) -> u64;
-  auto interpolate1f(u64 a, u64 b, u64 c, u64 d, f64 x, f64 y) -> u64;
-  auto interpolate1i(s64 a, s64 b, u32 x) -> u64;
-  auto interpolate1i(s64 a, s64 b, s64 c, s64 d, u32 x, u32 y) -> u64;
-  auto interpolate4f(u64 a, u64 b, f64 x) -> u64;
-  auto interpolate4f(u64 a, u64 b, u64 c, u64 d, f64 x, f64 y) -> u64;
-  auto interpolate4i(u64 a, u64 b, u32 x) -> u64;
-  auto interpolate4i(u64 a, u64 b, u64 c, u64 d, u32 x, u32 y) -> u64;
+  static auto interpolate1f(u64 a, u64 b, f64 x) -> u64;
+  static auto interpolate1f(u64 a, u64 b, u64 c, u64 d, f64 x, f64 y) -> u64;
+  static auto interpolate1i(s64 a, s64 b, u32 x) -> u64;
+  static auto interpolate1i(s64 a, s64 b, s64 c, s64 d, u32 x, u32 y) -> u64;
+  template<typename P> static auto interpolate4f(const P& pixel, u64 a, u64 b, f64 x) -> u64;
+  template<typename P> static auto interpolate4f(const P& pixel, u64 a, u64 b, u64 c, u64 d, f64 x, f64 y) -> u64;
+  template<typename P> static auto interpolate4i(const P& pixel, u64 a, u64 b, u32 x) -> u64;
+  template<typename P> static auto interpolate4i(const P& pixel, u64 a, u64 b, u64 c, u64 d, u32 x, u32 y) -> u64;
 
   u8* _data   = nullptr;
   u32 _width  = 0;
@@ -161,9 +209,14 @@ private:
 
 #include <nall/image/static.hpp>
 #include <nall/image/core.hpp>
+#include <nall/image/pixel.hpp>
+#include <nall/image/kernel.hpp>
+#include <nall/image/parallel.hpp>
 #include <nall/image/load.hpp>
 #include <nall/image/interpolation.hpp>
 #include <nall/image/fill.hpp>
 #include <nall/image/scale.hpp>
+#include <nall/image/resample.hpp>
 #include <nall/image/blend.hpp>
 #include <nall/image/utility.hpp>
+#include <nall/image/encode.hpp>
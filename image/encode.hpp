@@ -0,0 +1,30 @@
+#pragma once
+
+namespace nall {
+
+//images are encoded from 32-bit ARGB pixels; other formats are converted into a temporary copy first
+//the alpha channel is written only when the image has one
+
+inline auto image::encodePNG() const -> vector<u8> {
+  if(!_data) return {};
+  if(ARGB8888::matches(*this)) {
+    if(_alpha.depth()) return Encode::PNG::RGBA8(_data, pitch(), _width, _height);
+    return Encode::PNG::RGB8(_data, pitch(), _width, _height);
+  }
+  image argb = *this;
+  argb.transform();
+  if(_alpha.depth()) return Encode::PNG::RGBA8(argb.data(), argb.pitch(), _width, _height);
+  return Encode::PNG::RGB8(argb.data(), argb.pitch(), _width, _height);
+}
+
+inline auto image::encodeBMP() const -> vector<u8> {
+  if(!_data) return {};
+  if(ARGB8888::matches(*this)) {
+    return Encode::BMP::create(_data, pitch(), _width, _height, _alpha.depth() > 0);
+  }
+  image argb = *this;
+  argb.transform();
+  return Encode::BMP::create(argb.data(), argb.pitch(), _width, _height, _alpha.depth() > 0);
+}
+
+}
@@ -3,39 +3,52 @@
 namespace nall {
 
 inline auto image::fill(u64 color) -> void {
-  for(u32 y = 0; y < _height; y++) {
-    u8* dp = _data + pitch() * y;
-    for(u32 x = 0; x < _width; x++) {
-      write(dp, color);
-      dp += stride();
-    }
-  }
+  dispatch([&](auto pixel) {
+    bands(_height, pitch(), (u64)_width * _height, [&](u32 first, u32 last) {
+      for(u32 y = first; y < last; y++) {
+        u8* dp = _data + pitch() * y;
+        for(u32 x = 0; x < _width; x++) {
+          pixel.write(dp, color);
+          dp += pixel.stride();
+        }
+      }
+    });
+  });
 }
 
 inline auto image::gradient(u64 a, u64 b, u64 c, u64 d) -> void {
-  for(u32 y = 0; y < _height; y++) {
-    u8* dp = _data + pitch() * y;
-    f64 muY = (f64)y / (f64)_height;
-    for(u32 x = 0; x < _width; x++) {
-      f64 muX = (f64)x / (f64)_width;
-      write(dp, interpolate4f(a, b, c, d, muX, muY));
-      dp += stride();
-    }
-  }
+  dispatch([&](auto pixel) {
+    bands(_height, pitch(), (u64)_width * _height * 4, [&](u32 first, u32 last) {
+      for(u32 y = first; y < last; y++) {
+        u8* dp = _data + pitch() * y;
+        f64 muY = (f64)y / (f64)_height;
+        for(u32 x = 0; x < _width; x++) {
+          f64 muX = (f64)x / (f64)_width;
+          pixel.write(dp, interpolate4f(pixel, a, b, c, d, muX, muY));
+          dp += pixel.stride();
+        }
+      }
+    });
+  });
 }
 
+//once image::setThreads() has enabled parallelism, callback may be invoked from several threads at once
 inline auto image::gradient(u64 a, u64 b, s32 radiusX, s32 radiusY, s32 centerX, s32 centerY, function<f64 (f64, f64)> callback) -> void {
-  for(s32 y = 0; y < _height; y++) {
-    u8* dp = _data + pitch() * y;
-    f64 py = max(-radiusY, min(+radiusY, y - centerY)) * 1.0 / radiusY;
-    for(s32 x = 0; x < _width; x++) {
-      f64 px = max(-radiusX, min(+radiusX, x - centerX)) * 1.0 / radiusX;
-      f64 mu = max(0.0, min(1.0, callback(px, py)));
-      if(mu != mu) mu = 1.0;  //NaN
-      write(dp, interpolate4f(a, b, mu));
-      dp += stride();
-    }
-  }
+  dispatch([&](auto pixel) {
+    bands(_height, pitch(), (u64)_width * _height * 4, [&](s32 first, s32 last) {
+      for(s32 y = first; y < last; y++) {
+        u8* dp = _data + pitch() * y;
+        f64 py = max(-radiusY, min(+radiusY, y - centerY)) * 1.0 / radiusY;
+        for(s32 x = 0; x < _width; x++) {
+          f64 px = max(-radiusX, min(+radiusX, x - centerX)) * 1.0 / radiusX;
+          f64 mu = max(0.0, min(1.0, callback(px, py)));
+          if(mu != mu) mu = 1.0;  //NaN
+          pixel.write(dp, interpolate4f(pixel, a, b, mu));
+          dp += pixel.stride();
+        }
+      }
+    });
+  });
 }
 
 inline auto image::crossGradient(u64 a, u64 b, s32 radiusX, s32 radiusY, s32 centerX, s32 centerY) -> void {
@@ -0,0 +1,270 @@
+#pragma once
+
+//row kernels for the Alpha8888 pixel formats (see pixel.hpp)
+//each produces bit-identical results to the generic per-pixel code they replace
+//SSE2 is part of the amd64 baseline; other targets use the scalar loops
+
+namespace nall {
+
+//color = color * alpha / 255, computed as (p + 1 + (p >> 8)) >> 8, which is exact for p <= 255 * 255
+inline auto image::alphaMultiply8888(u8* data, u32 width) -> void {
+  u32 x = 0;
+  #if defined(__SSE2__)
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i one = _mm_set1_epi16(1);
+  const __m128i alphaLanes = _mm_set_epi16(-1, 0, 0, 0, -1, 0, 0, 0);
+  for(; x + 4 <= width; x += 4, data += 16) {
+    __m128i pixels = _mm_loadu_si128((const __m128i*)data);
+    __m128i result[2];
+    for(u32 half : range(2)) {
+      __m128i color = half ? _mm_unpackhi_epi8(pixels, zero) : _mm_unpacklo_epi8(pixels, zero);
+      __m128i alpha = _mm_shufflehi_epi16(_mm_shufflelo_epi16(color, 0xff), 0xff);
+      __m128i product = _mm_mullo_epi16(color, alpha);
+      product = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(product, one), _mm_srli_epi16(product, 8)), 8);
+      result[half] = _mm_or_si128(_mm_andnot_si128(alphaLanes, product), _mm_and_si128(alphaLanes, color));
+    }
+    _mm_storeu_si128((__m128i*)data, _mm_packus_epi16(result[0], result[1]));
+  }
+  #endif
+  for(; x < width; x++, data += 4) {
+    u32 alpha = data[3];
+    data[0] = data[0] * alpha / 255;
+    data[1] = data[1] * alpha / 255;
+    data[2] = data[2] * alpha / 255;
+  }
+}
+
+//source and target pixels share the same Alpha8888 format
+inline auto image::impose8888(blend mode, u8* target, const u8* source, u32 width) -> void {
+  if(mode == blend::targetColor) return;
+  if(mode == blend::sourceColor) return (void)memcpy(target, source, width * 4);
+
+  u32 x = 0;
+  #if defined(__SSE2__)
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i alphaLanes = _mm_set_epi16(-1, 0, 0, 0, -1, 0, 0, 0);
+  for(; x + 4 <= width; x += 4, target += 16, source += 16) {
+    __m128i sourcePixels = _mm_loadu_si128((const __m128i*)source);
+    __m128i targetPixels = _mm_loadu_si128((const __m128i*)target);
+    __m128i result[2];
+    for(u32 half : range(2)) {
+      __m128i s = half ? _mm_unpackhi_epi8(sourcePixels, zero) : _mm_unpacklo_epi8(sourcePixels, zero);
+      __m128i d = half ? _mm_unpackhi_epi8(targetPixels, zero) : _mm_unpacklo_epi8(targetPixels, zero);
+      __m128i sa = _mm_shufflehi_epi16(_mm_shufflelo_epi16(s, 0xff), 0xff);
+      __m128i da = _mm_shufflehi_epi16(_mm_shufflelo_epi16(d, 0xff), 0xff);
+      __m128i color;
+      if(mode == blend::add) {
+        color = _mm_adds_epu16(_mm_srli_epi16(_mm_mullo_epi16(s, sa), 8), _mm_srli_epi16(_mm_mullo_epi16(d, da), 8));
+      } else {
+        //((x - y) * alpha) >> 8 == mulhi((x - y) << 7, alpha << 1), including the rounding of negative values
+        __m128i base  = mode == blend::sourceAlpha ? d  : s;
+        __m128i other = mode == blend::sourceAlpha ? s  : d;
+        __m128i alpha = mode == blend::sourceAlpha ? sa : da;
+        __m128i delta = _mm_slli_epi16(_mm_sub_epi16(other, base), 7);
+        color = _mm_add_epi16(base, _mm_mulhi_epi16(delta, _mm_slli_epi16(alpha, 1)));
+      }
+      result[half] = _mm_or_si128(_mm_andnot_si128(alphaLanes, color), _mm_and_si128(alphaLanes, _mm_max_epi16(s, d)));
+    }
+    _mm_storeu_si128((__m128i*)target, _mm_packus_epi16(result[0], result[1]));
+  }
+  #endif
+  for(; x < width; x++, target += 4, source += 4) {
+    s32 sa = source[3], da = target[3];
+    for(u32 n : range(3)) {
+      s32 s = source[n], d = target[n];
+      if(mode == blend::add) target[n] = min(255, (s * sa >> 8) + (d * da >> 8));
+      if(mode == blend::sourceAlpha) target[n] = d + ((s - d) * sa >> 8);
+      if(mode == blend::targetAlpha) target[n] = s + ((d - s) * da >> 8);
+    }
+    target[3] = max(sa, da);
+  }
+}
+
+//exchanges the channels in bytes 0 and 2 (ARGB8888 <> ABGR8888)
+inline auto image::swap8888(u8* target, const u8* source, u32 width) -> void {
+  u32 x = 0;
+  #if defined(__SSE2__)
+  const __m128i keep = _mm_set1_epi32(0xff00ff00);
+  const __m128i low = _mm_set1_epi32(0x000000ff);
+  for(; x + 4 <= width; x += 4, target += 16, source += 16) {
+    __m128i pixels = _mm_loadu_si128((const __m128i*)source);
+    __m128i result = _mm_and_si128(pixels, keep);
+    result = _mm_or_si128(result, _mm_and_si128(_mm_srli_epi32(pixels, 16), low));
+    result = _mm_or_si128(result, _mm_slli_epi32(_mm_and_si128(pixels, low), 16));
+    _mm_storeu_si128((__m128i*)target, result);
+  }
+  #endif
+  for(; x < width; x++, target += 4, source += 4) {
+    u8 byte0 = source[0], byte2 = source[2];
+    target[0] = byte2;
+    target[1] = source[1];
+    target[2] = byte0;
+    target[3] = source[3];
+  }
+}
+
+//ARGB8888 -> RGB565; alpha is discarded
+inline auto image::pack565(u8* target, const u8* source, u32 width) -> void {
+  u32 x = 0;
+  #if defined(__SSE2__)
+  const __m128i red = _mm_set1_epi32(0xf800);
+  const __m128i green = _mm_set1_epi32(0x07e0);
+  const __m128i blue = _mm_set1_epi32(0x001f);
+  for(; x + 8 <= width; x += 8, target += 16, source += 32) {
+    __m128i result[2];
+    for(u32 half : range(2)) {
+      __m128i pixels = _mm_loadu_si128((const __m128i*)(source + half * 16));
+      __m128i color = _mm_and_si128(_mm_srli_epi32(pixels, 8), red);
+      color = _mm_or_si128(color, _mm_and_si128(_mm_srli_epi32(pixels, 5), green));
+      color = _mm_or_si128(color, _mm_and_si128(_mm_srli_epi32(pixels, 3), blue));
+      //sign-extend so that the signed saturation of packs is a plain truncation
+      result[half] = _mm_srai_epi32(_mm_slli_epi32(color, 16), 16);
+    }
+    _mm_storeu_si128((__m128i*)target, _mm_packs_epi32(result[0], result[1]));
+  }
+  #endif
+  for(; x < width; x++, target += 2, source += 4) {
+    u16 color = (source[2] >> 3) << 11 | (source[1] >> 2) << 5 | source[0] >> 3;
+    target[0] = color >> 0;
+    target[1] = color >> 8;
+  }
+}
+
+//RGB565 -> ARGB8888; channels are widened by bit replication, and alpha is zero (as normalize() yields)
+inline auto image::unpack565(u8* target, const u8* source, u32 width) -> void {
+  u32 x = 0;
+  #if defined(__SSE2__)
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i mask5 = _mm_set1_epi32(0x1f);
+  const __m128i mask6 = _mm_set1_epi32(0x3f);
+  for(; x + 8 <= width; x += 8, target += 32, source += 16) {
+    __m128i pixels = _mm_loadu_si128((const __m128i*)source);
+    for(u32 half : range(2)) {
+      __m128i color = half ? _mm_unpackhi_epi16(pixels, zero) : _mm_unpacklo_epi16(pixels, zero);
+      __m128i r = _mm_and_si128(_mm_srli_epi32(color, 11), mask5);
+      __m128i g = _mm_and_si128(_mm_srli_epi32(color,  5), mask6);
+      __m128i b = _mm_and_si128(color, mask5);
+      r = _mm_or_si128(_mm_slli_epi32(r, 3), _mm_srli_epi32(r, 2));
+      g = _mm_or_si128(_mm_slli_epi32(g, 2), _mm_srli_epi32(g, 4));
+      b = _mm_or_si128(_mm_slli_epi32(b, 3), _mm_srli_epi32(b, 2));
+      __m128i result = _mm_or_si128(_mm_or_si128(_mm_slli_epi32(r, 16), _mm_slli_epi32(g, 8)), b);
+      _mm_storeu_si128((__m128i*)(target + half * 16), result);
+    }
+  }
+  #endif
+  for(; x < width; x++, target += 4, source += 2) {
+    u16 color = source[0] | source[1] << 8;
+    u8 r = color >> 11 & 31, g = color >> 5 & 63, b = color & 31;
+    target[0] = b << 3 | b >> 2;
+    target[1] = g << 2 | g >> 4;
+    target[2] = r << 3 | r >> 2;
+    target[3] = 0;
+  }
+}
+
+//per-channel a + ((b - a) * x >> 32), evaluated as (a * 2^32 + b * x - a * x) >> 32 in unsigned 64-bit lanes
+inline auto image::interpolate8888(u32 a, u32 b, u32 x) -> u32 {
+  #if defined(__SSE2__)
+  const __m128i zero = _mm_setzero_si128();
+  auto widen = [&](u32 color, __m128i& lo, __m128i& hi) {
+    __m128i channels = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(color), zero), zero);
+    lo = _mm_unpacklo_epi32(channels, zero);
+    hi = _mm_unpackhi_epi32(channels, zero);
+  };
+  __m128i alo, ahi, blo, bhi;
+  widen(a, alo, ahi);
+  widen(b, blo, bhi);
+  __m128i fraction = _mm_set1_epi32(x);
+  auto lerp = [&](__m128i a, __m128i b) {
+    __m128i sum = _mm_add_epi64(_mm_slli_epi64(a, 32), _mm_mul_epu32(b, fraction));
+    return _mm_srli_epi64(_mm_sub_epi64(sum, _mm_mul_epu32(a, fraction)), 32);
+  };
+  __m128i lo = _mm_shuffle_epi32(lerp(alo, blo), 0x08);  //lanes 0, 2 -> 0, 1
+  __m128i hi = _mm_shuffle_epi32(lerp(ahi, bhi), 0x08);
+  __m128i channels = _mm_packs_epi32(_mm_unpacklo_epi64(lo, hi), zero);
+  return _mm_cvtsi128_si32(_mm_packus_epi16(channels, zero));
+  #else
+  u32 result = 0;
+  for(u32 n : range(4)) {
+    s64 ca = a >> n * 8 & 255, cb = b >> n * 8 & 255;
+    result |= (u32)(ca + ((cb - ca) * x >> 32)) << n * 8;
+  }
+  return result;
+  #endif
+}
+
+//one row of a horizontal resampling pass (see resample.hpp)
+//output pixel x is the weighted sum of the taps source pixels starting at first[x], with 2.14 fixed-point weights
+inline auto image::resampleWidth8888(u8* target, const u8* source, u32 width, const u32* first, const s16* weights, u32 taps) -> void {
+  #if defined(__SSE2__)
+  const __m128i zero = _mm_setzero_si128();
+  for(u32 x : range(width)) {
+    const u8* sp = source + first[x] * 4;
+    const s16* w = weights + x * taps;
+    __m128i sum = _mm_set1_epi32(1 << 13);
+    u32 t = 0;
+    //two pixels per step: interleave their channels so that madd pairs each channel with its two weights
+    for(; t + 2 <= taps; t += 2) {
+      __m128i pixels = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(sp + t * 4)), zero);
+      __m128i pairs = _mm_unpacklo_epi16(pixels, _mm_srli_si128(pixels, 8));
+      sum = _mm_add_epi32(sum, _mm_madd_epi16(pairs, _mm_set1_epi32((u16)w[t] | (u32)(u16)w[t + 1] << 16)));
+    }
+    if(t < taps) {
+      u32 color;
+      memcpy(&color, sp + t * 4, 4);
+      __m128i pairs = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(color), zero), zero);
+      sum = _mm_add_epi32(sum, _mm_madd_epi16(pairs, _mm_set1_epi32((u16)w[t])));
+    }
+    sum = _mm_srai_epi32(sum, 14);
+    sum = _mm_packs_epi32(sum, sum);
+    u32 color = _mm_cvtsi128_si32(_mm_packus_epi16(sum, sum));
+    memcpy(target + x * 4, &color, 4);
+  }
+  #else
+  for(u32 x : range(width)) {
+    const u8* sp = source + first[x] * 4;
+    const s16* w = weights + x * taps;
+    s32 sum[4] = {1 << 13, 1 << 13, 1 << 13, 1 << 13};
+    for(u32 t : range(taps)) {
+      for(u32 n : range(4)) sum[n] += w[t] * sp[t * 4 + n];
+    }
+    for(u32 n : range(4)) target[x * 4 + n] = max(0, min(255, sum[n] >> 14));
+  }
+  #endif
+}
+
+//one row of a vertical resampling pass (see resample.hpp)
+//each output byte is the weighted sum of the same byte in taps consecutive source rows, pitch bytes apart
+inline auto image::resampleHeight8888(u8* target, const u8* source, u32 pitch, u32 width, const s16* weights, u32 taps) -> void {
+  u32 length = width * 4, x = 0;
+  #if defined(__SSE2__)
+  const __m128i zero = _mm_setzero_si128();
+  for(; x + 16 <= length; x += 16) {
+    __m128i sum[4];
+    for(auto& lane : sum) lane = _mm_set1_epi32(1 << 13);
+    //two rows per step: interleave their bytes so that madd pairs each byte with its two weights
+    for(u32 t = 0; t < taps; t += 2) {
+      bool pair = t + 1 < taps;
+      __m128i a = _mm_loadu_si128((const __m128i*)(source + pitch * t + x));
+      __m128i b = pair ? _mm_loadu_si128((const __m128i*)(source + pitch * (t + 1) + x)) : zero;
+      __m128i weight = _mm_set1_epi32((u16)weights[t] | (pair ? (u32)(u16)weights[t + 1] << 16 : 0));
+      __m128i lo = _mm_unpacklo_epi8(a, zero), loNext = _mm_unpacklo_epi8(b, zero);
+      __m128i hi = _mm_unpackhi_epi8(a, zero), hiNext = _mm_unpackhi_epi8(b, zero);
+      sum[0] = _mm_add_epi32(sum[0], _mm_madd_epi16(_mm_unpacklo_epi16(lo, loNext), weight));
+      sum[1] = _mm_add_epi32(sum[1], _mm_madd_epi16(_mm_unpackhi_epi16(lo, loNext), weight));
+      sum[2] = _mm_add_epi32(sum[2], _mm_madd_epi16(_mm_unpacklo_epi16(hi, hiNext), weight));
+      sum[3] = _mm_add_epi32(sum[3], _mm_madd_epi16(_mm_unpackhi_epi16(hi, hiNext), weight));
+    }
+    for(auto& lane : sum) lane = _mm_srai_epi32(lane, 14);
+    __m128i result = _mm_packus_epi16(_mm_packs_epi32(sum[0], sum[1]), _mm_packs_epi32(sum[2], sum[3]));
+    _mm_storeu_si128((__m128i*)(target + x), result);
+  }
+  #endif
+  for(; x < length; x++) {
+    s32 sum = 1 << 13;
+    for(u32 t : range(taps)) sum += weights[t] * source[pitch * t + x];
+    target[x] = max(0, min(255, sum >> 14));
+  }
+}
+
+}
@@ -39,61 +39,84 @@ inline auto image::loadPNG(const string& filename) -> bool {
 
 inline auto image::loadPNG(const u8* pngData, u32 pngSize) -> bool {
   Decode::PNG source;
-  if(!source.load(pngData, pngSize)) return false;
+  if(!source.parse(pngData, pngSize)) return false;
 
   allocate(source.info.width, source.info.height);
-  const u8* sp = source.data;
-  u8* dp = _data;
-
-  auto decode = [&]() -> u64 {
-    u64 p = 0, r = 0, g = 0, b = 0, a = 0;
-
-    switch(source.info.colorType) {
-    case 0:  //L
-      r = g = b = source.readbits(sp);
-      a = (1 << source.info.bitDepth) - 1;
-      break;
-    case 2:  //R,G,B
-      r = source.readbits(sp);
-      g = source.readbits(sp);
-      b = source.readbits(sp);
-      a = (1 << source.info.bitDepth) - 1;
-      break;
-    case 3:  //P
-      p = source.readbits(sp);
-      r = source.info.palette[p][0];
-      g = source.info.palette[p][1];
-      b = source.info.palette[p][2];
-      a = (1 << source.info.bitDepth) - 1;
-      break;
-    case 4:  //L,A
-      r = g = b = source.readbits(sp);
-      a = source.readbits(sp);
-      break;
-    case 6:  //R,G,B,A
-      r = source.readbits(sp);
-      g = source.readbits(sp);
-      b = source.readbits(sp);
-      a = source.readbits(sp);
-      break;
-    }
-
-    a = normalize(a, source.info.bitDepth, _alpha.depth());
-    r = normalize(r, source.info.bitDepth, _red.depth());
-    g = normalize(g, source.info.bitDepth, _green.depth());
-    b = normalize(b, source.info.bitDepth, _blue.depth());
-
-    return (a << _alpha.shift()) | (r << _red.shift()) | (g << _green.shift()) | (b << _blue.shift());
+  const auto& info = source.info;
+  u32 depth = info.bitDepth;
+  u64 opaque = (1 << depth) - 1;
+
+  //samples narrower than a byte are packed starting from the most significant bit
+  auto sample = [&](const u8* row, u32 index) -> u64 {
+    if(depth == 8) return row[index];
+    if(depth == 16) return row[index * 2 + 0] << 8 | row[index * 2 + 1] << 0;
+    u32 bit = index * depth;
+    return row[bit >> 3] >> (8 - depth - (bit & 7)) & opaque;
   };
 
-  for(u32 y = 0; y < _height; y++) {
-    for(u32 x = 0; x < _width; x++) {
-      write(dp, decode());
-      dp += stride();
-    }
-  }
-
-  return true;
+  bool result = false;
+  dispatch([&](auto pixel) {
+    //rows are converted as soon as they are decoded, straight into the image
+    result = source.decode([&](u32 y, u32 x, u32 step, u32 width, const u8* row) {
+      u8* dp = _data + pitch() * y + pixel.stride() * x;
+
+      if constexpr(is_same_v<decltype(pixel), ARGB8888>) {
+        if(step == 1 && depth == 8 && info.colorType == 6) {
+          return swap8888(dp, row, width);
+        }
+        if(step == 1 && depth == 8 && info.colorType == 2) {
+          for(u32 n : range(width)) {
+            dp[0] = row[2], dp[1] = row[1], dp[2] = row[0], dp[3] = 255;
+            dp += 4, row += 3;
+          }
+          return;
+        }
+      }
+
+      for(u32 n : range(width)) {
+        u64 r = 0, g = 0, b = 0, a = opaque, sourceDepth = depth;
+        switch(info.colorType) {
+        case 0:  //L
+          r = g = b = sample(row, n);
+          break;
+        case 2:  //R,G,B
+          r = sample(row, n * 3 + 0);
+          g = sample(row, n * 3 + 1);
+          b = sample(row, n * 3 + 2);
+          break;
+        case 3: {  //P
+          u64 p = sample(row, n);
+          r = info.palette[p][0];
+          g = info.palette[p][1];
+          b = info.palette[p][2];
+          a = 255, sourceDepth = 8;
+          break;
+        }
+        case 4:  //L,A
+          r = g = b = sample(row, n * 2 + 0);
+          a = sample(row, n * 2 + 1);
+          break;
+        case 6:  //R,G,B,A
+          r = sample(row, n * 4 + 0);
+          g = sample(row, n * 4 + 1);
+          b = sample(row, n * 4 + 2);
+          a = sample(row, n * 4 + 3);
+          break;
+        }
+
+        a = normalize(a, sourceDepth, _alpha.depth());
+        r = normalize(r, sourceDepth, _red.depth());
+        g = normalize(g, sourceDepth, _green.depth());
+        b = normalize(b, sourceDepth, _blue.depth());
+
+        pixel.write(dp, (a << _alpha.shift()) | (r << _red.shift()) | (g << _green.shift()) | (b << _blue.shift()));
+        dp += pixel.stride() * step;
+      }
+    });
+  });
+
+  if(!result) free();
+  return result;
 }
 
 }
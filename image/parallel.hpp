@@ -0,0 +1,39 @@
+#pragma once
+
+namespace nall {
+
+//row-band parallelism for image operations
+//rows are split into bands of about BandBytes each, and the bands are handed out to threads by nall::parallel
+//every band writes its own rows of the output, so results are identical for any number of threads
+//parallelism is opt-in: image operations stay on the calling thread until setThreads() is called,
+//since once enabled, gradient() invokes its callback from several threads at once
+
+inline auto image::setThreads(u32 threads) -> void {
+  concurrency() = threads;  //0 = one per hardware thread, 1 = single-threaded (default)
+}
+
+inline auto image::threads() -> u32 {
+  u32 threads = concurrency();
+  return threads ? threads : parallel::concurrency();
+}
+
+inline auto image::concurrency() -> atomic<u32>& {
+  static atomic<u32> threads = 1;
+  return threads;
+}
+
+//invokes callback(firstRow, lastRow) for consecutive bands of [0, rows)
+//work estimates the number of pixel operations: small jobs stay on the calling thread
+template<typename F> inline auto image::bands(u32 rows, u32 pitch, u64 work, const F& callback) -> void {
+  static constexpr u32 BandBytes = 64 * 1024;
+  static constexpr u64 MinimumWork = 256 * 1024;
+
+  u32 bandRows = max(1u, BandBytes / max(1u, pitch));
+  u32 count = (rows + bandRows - 1) / bandRows;
+  parallel::run(count, [&](u32 band) {
+    u32 first = band * bandRows;
+    callback(first, min(rows, first + bandRows));
+  }, work < MinimumWork ? 1 : threads());
+}
+
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+namespace nall {
+
+//pixel formats known at compile-time
+//operations are instantiated once per format through dispatch(), so that the common formats compile down to
+//constant shifts and masks; Generic defers to the runtime channel masks of the image, and handles everything else
+
+struct image::Generic {
+  static constexpr bool Alpha8888 = false;
+
+  Generic(const image& self) : self(self) {}
+
+  auto stride() const -> u32 { return self.stride(); }
+  auto read(const u8* data) const -> u64 { return self.read(data); }
+  auto write(u8* data, u64 color) const -> void { self.write(data, color); }
+
+  auto split(u64 c[4], u64 color) const -> void {
+    c[0] = (color & self._alpha.mask()) >> self._alpha.shift();
+    c[1] = (color & self._red.mask()  ) >> self._red.shift();
+    c[2] = (color & self._green.mask()) >> self._green.shift();
+    c[3] = (color & self._blue.mask() ) >> self._blue.shift();
+  }
+
+  auto merge(const u64 c[4]) const -> u64 {
+    return c[0] << self._alpha.shift() | c[1] << self._red.shift() | c[2] << self._green.shift() | c[3] << self._blue.shift();
+  }
+
+  const image& self;
+};
+
+//little-endian packed pixel of 16 or 32 bits
+template<u32 Depth, u64 AlphaMask, u64 RedMask, u64 GreenMask, u64 BlueMask>
+struct image::Packed {
+  static constexpr auto shift(u64 mask) -> u32 {
+    u32 shift = 0;
+    if(mask) while((mask & 1) == 0) mask >>= 1, shift++;
+    return shift;
+  }
+
+  static constexpr u32 Stride = Depth / 8;
+  static constexpr u32 AlphaShift = shift(AlphaMask);
+  static constexpr u32 RedShift   = shift(RedMask);
+  static constexpr u32 GreenShift = shift(GreenMask);
+  static constexpr u32 BlueShift  = shift(BlueMask);
+
+  //32-bit formats with 8-bit channels and alpha in the top byte share the SIMD kernels of kernel.hpp
+  static constexpr bool Alpha8888 = Depth == 32 && AlphaMask == 0xff000000
+    && (RedMask | GreenMask | BlueMask) == 0x00ffffff
+    && (RedMask >> RedShift) == 0xff && (GreenMask >> GreenShift) == 0xff && (BlueMask >> BlueShift) == 0xff;
+
+  Packed(const image&) {}
+
+  static auto matches(const image& self) -> bool {
+    return self._endian == 0 && self._depth == Depth
+        && self._alpha.mask() == AlphaMask && self._red.mask() == RedMask
+        && self._green.mask() == GreenMask && self._blue.mask() == BlueMask;
+  }
+
+  auto stride() const -> u32 { return Stride; }
+
+  auto read(const u8* data) const -> u64 {
+    if constexpr(Depth == 16) return data[0] << 0 | data[1] << 8;
+    if constexpr(Depth == 32) return data[0] << 0 | data[1] << 8 | data[2] << 16 | (u32)data[3] << 24;
+  }
+
+  auto write(u8* data, u64 color) const -> void {
+    data[0] = color >> 0;
+    data[1] = color >> 8;
+    if constexpr(Depth == 32) {
+      data[2] = color >> 16;
+      data[3] = color >> 24;
+    }
+  }
+
+  auto split(u64 c[4], u64 color) const -> void {
+    c[0] = (color & AlphaMask) >> AlphaShift;
+    c[1] = (color & RedMask  ) >> RedShift;
+    c[2] = (color & GreenMask) >> GreenShift;
+    c[3] = (color & BlueMask ) >> BlueShift;
+  }
+
+  auto merge(const u64 c[4]) const -> u64 {
+    return c[0] << AlphaShift | c[1] << RedShift | c[2] << GreenShift | c[3] << BlueShift;
+  }
+};
+
+template<typename F> inline auto image::dispatch(F&& callback) const -> void {
+  if(ARGB8888::matches(*this)) return callback(ARGB8888{*this});
+  if(ABGR8888::matches(*this)) return callback(ABGR8888{*this});
+  if(RGB565::matches(*this)) return callback(RGB565{*this});
+  return callback(Generic{*this});
+}
+
+}
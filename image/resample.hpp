@@ -0,0 +1,188 @@
+#pragma once
+
+namespace nall {
+
+//separable resampling filters
+//each axis is filtered on its own through a table of per-output-pixel weights that is computed once per pass;
+//weights are 2.14 fixed-point, and rows are processed in bands spread across threads (see parallel.hpp)
+//as with the linear filter, channels are filtered as stored (gamma-encoded), not in linear light
+
+struct image::Weights {
+  u32 taps = 0;              //number of consecutive source pixels contributing to each output pixel
+  vector<u32> first;         //first contributing source pixel of each output pixel
+  vector<s16> coefficients;  //taps weights per output pixel, each set summing to exactly 1 << 14
+};
+
+inline auto image::scale(u32 outputWidth, u32 outputHeight, filter mode) -> void {
+  if(!_data) return;
+  if(_width == outputWidth && _height == outputHeight) return;  //no scaling necessary
+  if(mode == filter::nearest) return scaleNearest(outputWidth, outputHeight);
+  if(mode == filter::linear) return scale(outputWidth, outputHeight, true);
+
+  if(_width  == outputWidth ) return resampleHeight(outputHeight, resampleWeights(mode, _height, outputHeight));
+  if(_height == outputHeight) return resampleWidth(outputWidth, resampleWeights(mode, _width, outputWidth));
+
+  //filter the axis first that leaves the least work for the second pass
+  auto horizontal = resampleWeights(mode, _width, outputWidth);
+  auto vertical = resampleWeights(mode, _height, outputHeight);
+  u64 dwh = (u64)outputWidth * _height * horizontal.taps + (u64)outputWidth * outputHeight * vertical.taps;
+  u64 dhw = (u64)_width * outputHeight * vertical.taps + (u64)outputWidth * outputHeight * horizontal.taps;
+
+  if(dwh <= dhw) return resampleWidth(outputWidth, horizontal), resampleHeight(outputHeight, vertical);
+  return resampleHeight(outputHeight, vertical), resampleWidth(outputWidth, horizontal);
+}
+
+inline auto image::resampleWeights(filter mode, u32 input, u32 output) -> Weights {
+  //when minifying, the kernel is stretched to cover every source pixel that maps onto an output pixel
+  f64 ratio = (f64)input / output;
+  f64 factor = max(1.0, ratio);
+
+  auto kernel = [&](f64 x) -> f64 {
+    x = fabs(x);
+    if(mode == filter::cubic) {
+      if(x < 1.0) return (1.5 * x - 2.5) * x * x + 1.0;
+      if(x < 2.0) return ((-0.5 * x + 2.5) * x - 4.0) * x + 2.0;
+      return 0.0;
+    }
+    if(mode == filter::lanczos) {
+      if(x == 0.0) return 1.0;
+      if(x < 3.0) return 3.0 * sin(Math::Pi * x) * sin(Math::Pi * x / 3.0) / (Math::Pi * Math::Pi * x * x);
+      return 0.0;
+    }
+    return 0.0;
+  };
+
+  //area weights are the exact overlap of each source pixel with the footprint of the output pixel
+  f64 radius = mode == filter::area ? factor * 0.5 + 0.5 : mode == filter::cubic ? factor * 2.0 : factor * 3.0;
+
+  Weights weights;
+  weights.taps = min(input, (u32)ceil(radius) * 2 + 1);
+  weights.first.resize(output);
+  weights.coefficients.resize(output * weights.taps);
+
+  vector<f64> sample;
+  sample.resize(weights.taps);
+  for(u32 x : range(output)) {
+    f64 center = (x + 0.5) * ratio - 0.5;
+    s32 lo = max(0, (s32)ceil(center - radius));
+    s32 hi = min((s32)input - 1, (s32)floor(center + radius));
+    u32 first = min((u32)lo, input - weights.taps);
+
+    f64 total = 0.0;
+    for(u32 t : range(weights.taps)) {
+      s32 source = first + t;
+      f64 weight = 0.0;
+      if(source >= lo && source <= hi) {
+        if(mode == filter::area) {
+          weight = max(0.0, min(source + 0.5, center + factor * 0.5) - max(source - 0.5, center - factor * 0.5));
+        } else {
+          weight = kernel((source - center) / factor);
+        }
+      }
+      sample[t] = weight;
+      total += weight;
+    }
+    if(total == 0.0) {
+      //degenerate footprint: fall back to the nearest source pixel
+      sample[max(lo, min(hi, (s32)round(center))) - first] = total = 1.0;
+    }
+
+    //round to fixed-point, and fold the rounding error into the largest weight so that flat areas are preserved exactly
+    s16* coefficients = weights.coefficients.data() + x * weights.taps;
+    s32 sum = 0;
+    u32 largest = 0;
+    for(u32 t : range(weights.taps)) {
+      coefficients[t] = (s16)round(sample[t] / total * (1 << 14));
+      sum += coefficients[t];
+      if(coefficients[t] > coefficients[largest]) largest = t;
+    }
+    coefficients[largest] += (1 << 14) - sum;
+    weights.first[x] = first;
+  }
+
+  return weights;
+}
+
+inline auto image::resampleWidth(u32 outputWidth, const Weights& weights) -> void {
+  u8* outputData = allocate(outputWidth, _height, stride());
+  u32 outputPitch = outputWidth * stride();
+
+  dispatch([&](auto pixel) {
+    u64 limit[4];
+    pixel.split(limit, ~0ull);
+
+    bands(_height, outputPitch, (u64)outputWidth * _height * weights.taps, [&](u32 first, u32 last) {
+      for(u32 y = first; y < last; y++) {
+        const u8* sp = _data + pitch() * y;
+        u8* dp = outputData + outputPitch * y;
+        if constexpr(decltype(pixel)::Alpha8888) {
+          resampleWidth8888(dp, sp, outputWidth, weights.first.data(), weights.coefficients.data(), weights.taps);
+          continue;
+        }
+
+        for(u32 x : range(outputWidth)) {
+          const u8* source = sp + weights.first[x] * pixel.stride();
+          const s16* w = weights.coefficients.data() + x * weights.taps;
+          s64 sum[4] = {1 << 13, 1 << 13, 1 << 13, 1 << 13};
+          for(u32 t : range(weights.taps)) {
+            u64 c[4];
+            pixel.split(c, pixel.read(source));
+            for(u32 n : range(4)) sum[n] += w[t] * (s64)c[n];
+            source += pixel.stride();
+          }
+          u64 c[4];
+          for(u32 n : range(4)) c[n] = max<s64>(0, min<s64>(limit[n], sum[n] >> 14));
+          pixel.write(dp, pixel.merge(c));
+          dp += pixel.stride();
+        }
+      }
+    });
+  });
+
+  free();
+  _data = outputData;
+  _width = outputWidth;
+}
+
+inline auto image::resampleHeight(u32 outputHeight, const Weights& weights) -> void {
+  u8* outputData = allocate(_width, outputHeight, stride());
+
+  //rows are filtered whole, so that every pass streams through memory in order
+  dispatch([&](auto pixel) {
+    u64 limit[4];
+    pixel.split(limit, ~0ull);
+
+    bands(outputHeight, pitch(), (u64)_width * outputHeight * weights.taps, [&](u32 first, u32 last) {
+      for(u32 y = first; y < last; y++) {
+        const u8* sp = _data + pitch() * weights.first[y];
+        const s16* w = weights.coefficients.data() + y * weights.taps;
+        u8* dp = outputData + pitch() * y;
+        if constexpr(decltype(pixel)::Alpha8888) {
+          resampleHeight8888(dp, sp, pitch(), _width, w, weights.taps);
+          continue;
+        }
+
+        for(u32 x : range(_width)) {
+          const u8* source = sp + x * pixel.stride();
+          s64 sum[4] = {1 << 13, 1 << 13, 1 << 13, 1 << 13};
+          for(u32 t : range(weights.taps)) {
+            u64 c[4];
+            pixel.split(c, pixel.read(source));
+            for(u32 n : range(4)) sum[n] += w[t] * (s64)c[n];
+            source += pitch();
+          }
+          u64 c[4];
+          for(u32 n : range(4)) c[n] = max<s64>(0, min<s64>(limit[n], sum[n] >> 14));
+          pixel.write(dp, pixel.merge(c));
+          dp += pixel.stride();
+        }
+      }
+    });
+  });
+
+  free();
+  _data = outputData;
+  _height = outputHeight;
+}
+
+}
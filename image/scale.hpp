@@ -27,31 +27,35 @@ inline auto image::scaleLinearWidth(u32 outputWidth) -> void {
   u32 outputPitch = outputWidth * stride();
   u64 xstride = ((u64)(_width - 1) << 32) / max(1u, outputWidth - 1);
 
-  for(u32 y = 0; y < _height; y++) {
-    u64 xfraction = 0;
-
-    const u8* sp = _data + pitch() * y;
-    u8* dp = outputData + outputPitch * y;
-
-    u64 a = read(sp);
-    u64 b = read(sp + stride());
-    sp += stride();
-
-    u32 x = 0;
-    while(true) {
-      while(xfraction < 0x100000000 && x++ < outputWidth) {
-        write(dp, interpolate4i(a, b, xfraction));
-        dp += stride();
-        xfraction += xstride;
+  dispatch([&](auto pixel) {
+    bands(_height, outputPitch, (u64)outputWidth * _height, [&](u32 first, u32 last) {
+      for(u32 y = first; y < last; y++) {
+        u64 xfraction = 0;
+
+        const u8* sp = _data + pitch() * y;
+        u8* dp = outputData + outputPitch * y;
+
+        u64 a = pixel.read(sp);
+        u64 b = pixel.read(sp + pixel.stride());
+        sp += pixel.stride();
+
+        u32 x = 0;
+        while(true) {
+          while(xfraction < 0x100000000 && x++ < outputWidth) {
+            pixel.write(dp, interpolate4i(pixel, a, b, xfraction));
+            dp += pixel.stride();
+            xfraction += xstride;
+          }
+          if(x >= outputWidth) break;
+
+          sp += pixel.stride();
+          a = b;
+          b = pixel.read(sp);
+          xfraction -= 0x100000000;
+        }
       }
-      if(x >= outputWidth) break;
-
-      sp += stride();
-      a = b;
-      b = read(sp);
-      xfraction -= 0x100000000;
-    }
-  }
+    });
+  });
 
   free();
   _data = outputData;
@@ -62,31 +66,26 @@ inline auto image::scaleLinearHeight(u32 outputHeight) -> void {
   u8* outputData = allocate(_width, outputHeight, stride());
   u64 ystride = ((u64)(_height - 1) << 32) / max(1u, outputHeight - 1);
 
-  for(u32 x = 0; x < _width; x++) {
-    u64 yfraction = 0;
-
-    const u8* sp = _data + stride() * x;
-    u8* dp = outputData + stride() * x;
-
-    u64 a = read(sp);
-    u64 b = read(sp + pitch());
-    sp += pitch();
-
-    u32 y = 0;
-    while(true) {
-      while(yfraction < 0x100000000 && y++ < outputHeight) {
-        write(dp, interpolate4i(a, b, yfraction));
-        dp += pitch();
-        yfraction += ystride;
+  //each output row blends two whole source rows, so that reads and writes both stream through memory in order
+  dispatch([&](auto pixel) {
+    bands(outputHeight, pitch(), (u64)_width * outputHeight, [&](u32 first, u32 last) {
+      for(u32 y = first; y < last; y++) {
+        u64 yfraction = ystride * y;
+        u32 row = yfraction >> 32;
+
+        const u8* sa = _data + pitch() * row;
+        const u8* sb = _data + pitch() * min(row + 1, _height - 1);
+        u8* dp = outputData + pitch() * y;
+
+        for(u32 x = 0; x < _width; x++) {
+          pixel.write(dp, interpolate4i(pixel, pixel.read(sa), pixel.read(sb), (u32)yfraction));
+          sa += pixel.stride();
+          sb += pixel.stride();
+          dp += pixel.stride();
+        }
       }
-      if(y >= outputHeight) break;
-
-      sp += pitch();
-      a = b;
-      b = read(sp);
-      yfraction -= 0x100000000;
-    }
-  }
+    });
+  });
 
   free();
   _data = outputData;
@@ -100,36 +99,40 @@ inline auto image::scaleLinear(u32 outputWidth, u32 outputHeight) -> void {
   u64 xstride = ((u64)(_width  - 1) << 32) / max(1u, outputWidth  - 1);
   u64 ystride = ((u64)(_height - 1) << 32) / max(1u, outputHeight - 1);
 
-  for(u32 y = 0; y < outputHeight; y++) {
-    u64 yfraction = ystride * y;
-    u64 xfraction = 0;
-
-    const u8* sp = _data + pitch() * (yfraction >> 32);
-    u8* dp = outputData + outputPitch * y;
-
-    u64 a = read(sp);
-    u64 b = read(sp + stride());
-    u64 c = read(sp + pitch());
-    u64 d = read(sp + pitch() + stride());
-    sp += stride();
-
-    u32 x = 0;
-    while(true) {
-      while(xfraction < 0x100000000 && x++ < outputWidth) {
-        write(dp, interpolate4i(a, b, c, d, xfraction, yfraction));
-        dp += stride();
-        xfraction += xstride;
+  dispatch([&](auto pixel) {
+    bands(outputHeight, outputPitch, (u64)outputWidth * outputHeight * 4, [&](u32 first, u32 last) {
+      for(u32 y = first; y < last; y++) {
+        u64 yfraction = ystride * y;
+        u64 xfraction = 0;
+
+        const u8* sp = _data + pitch() * (yfraction >> 32);
+        u8* dp = outputData + outputPitch * y;
+
+        u64 a = pixel.read(sp);
+        u64 b = pixel.read(sp + pixel.stride());
+        u64 c = pixel.read(sp + pitch());
+        u64 d = pixel.read(sp + pitch() + pixel.stride());
+        sp += pixel.stride();
+
+        u32 x = 0;
+        while(true) {
+          while(xfraction < 0x100000000 && x++ < outputWidth) {
+            pixel.write(dp, interpolate4i(pixel, a, b, c, d, xfraction, yfraction));
+            dp += pixel.stride();
+            xfraction += xstride;
+          }
+          if(x >= outputWidth) break;
+
+          sp += pixel.stride();
+          a = b;
+          c = d;
+          b = pixel.read(sp);
+          d = pixel.read(sp + pitch());
+          xfraction -= 0x100000000;
+        }
       }
-      if(x >= outputWidth) break;
-
-      sp += stride();
-      a = b;
-      c = d;
-      b = read(sp);
-      d = read(sp + pitch());
-      xfraction -= 0x100000000;
-    }
-  }
+    });
+  });
 
   free();
   _data = outputData;
@@ -144,29 +147,33 @@ inline auto image::scaleNearest(u32 outputWidth, u32 outputHeight) -> void {
   u64 xstride = ((u64)_width  << 32) / outputWidth;
   u64 ystride = ((u64)_height << 32) / outputHeight;
 
-  for(u32 y = 0; y < outputHeight; y++) {
-    u64 yfraction = ystride * y;
-    u64 xfraction = 0;
-
-    const u8* sp = _data + pitch() * (yfraction >> 32);
-    u8* dp = outputData + outputPitch * y;
-
-    u64 a = read(sp);
-
-    u32 x = 0;
-    while(true) {
-      while(xfraction < 0x100000000 && x++ < outputWidth) {
-        write(dp, a);
-        dp += stride();
-        xfraction += xstride;
+  dispatch([&](auto pixel) {
+    bands(outputHeight, outputPitch, (u64)outputWidth * outputHeight, [&](u32 first, u32 last) {
+      for(u32 y = first; y < last; y++) {
+        u64 yfraction = ystride * y;
+        u64 xfraction = 0;
+
+        const u8* sp = _data + pitch() * (yfraction >> 32);
+        u8* dp = outputData + outputPitch * y;
+
+        u64 a = pixel.read(sp);
+
+        u32 x = 0;
+        while(true) {
+          while(xfraction < 0x100000000 && x++ < outputWidth) {
+            pixel.write(dp, a);
+            dp += pixel.stride();
+            xfraction += xstride;
+          }
+          if(x >= outputWidth) break;
+
+          sp += pixel.stride();
+          a = pixel.read(sp);
+          xfraction -= 0x100000000;
+        }
       }
-      if(x >= outputWidth) break;
-
-      sp += stride();
-      a = read(sp);
-      xfraction -= 0x100000000;
-    }
-  }
+    });
+  });
 
   free();
   _data = outputData;
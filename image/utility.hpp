@@ -74,15 +74,13 @@ inline auto image::crop(u32 outputX, u32 outputY, u32 outputWidth, u32 outputHei
   u8* outputData = allocate(outputWidth, outputHeight, stride());
   u32 outputPitch = outputWidth * stride();
 
-  for(u32 y = 0; y < outputHeight; y++) {
-    const u8* sp = _data + pitch() * (outputY + y) + stride() * outputX;
-    u8* dp = outputData + outputPitch * y;
-    for(u32 x = 0; x < outputWidth; x++) {
-      write(dp, read(sp));
-      sp += stride();
-      dp += stride();
+  bands(outputHeight, outputPitch, (u64)outputWidth * outputHeight, [&](u32 first, u32 last) {
+    for(u32 y = first; y < last; y++) {
+      const u8* sp = _data + pitch() * (outputY + y) + stride() * outputX;
+      u8* dp = outputData + outputPitch * y;
+      memcpy(dp, sp, outputPitch);
     }
-  }
+  });
 
   delete[] _data;
   _data = outputData;
@@ -96,49 +94,54 @@ inline auto image::alphaBlend(u64 alphaColor) -> void {
   u64 alphaG = (alphaColor & _green.mask()) >> _green.shift();
   u64 alphaB = (alphaColor & _blue.mask() ) >> _blue.shift();
 
-  for(u32 y = 0; y < _height; y++) {
-    u8* dp = _data + pitch() * y;
-    for(u32 x = 0; x < _width; x++) {
-      u64 color = read(dp);
-
-      u64 colorA = (color & _alpha.mask()) >> _alpha.shift();
-      u64 colorR = (color & _red.mask()  ) >> _red.shift();
-      u64 colorG = (color & _green.mask()) >> _green.shift();
-      u64 colorB = (color & _blue.mask() ) >> _blue.shift();
-      f64 alphaScale = (f64)colorA / (f64)((1 << _alpha.depth()) - 1);
-
-      colorA = (1 << _alpha.depth()) - 1;
-      colorR = (colorR * alphaScale) + (alphaR * (1.0 - alphaScale));
-      colorG = (colorG * alphaScale) + (alphaG * (1.0 - alphaScale));
-      colorB = (colorB * alphaScale) + (alphaB * (1.0 - alphaScale));
-
-      write(dp, (colorA << _alpha.shift()) | (colorR << _red.shift()) | (colorG << _green.shift()) | (colorB << _blue.shift()));
-      dp += stride();
-    }
-  }
+  dispatch([&](auto pixel) {
+    bands(_height, pitch(), (u64)_width * _height, [&](u32 first, u32 last) {
+      for(u32 y = first; y < last; y++) {
+        u8* dp = _data + pitch() * y;
+        for(u32 x = 0; x < _width; x++) {
+          u64 c[4];
+          pixel.split(c, pixel.read(dp));
+          f64 alphaScale = (f64)c[0] / (f64)((1 << _alpha.depth()) - 1);
+
+          c[0] = (1 << _alpha.depth()) - 1;
+          c[1] = (c[1] * alphaScale) + (alphaR * (1.0 - alphaScale));
+          c[2] = (c[2] * alphaScale) + (alphaG * (1.0 - alphaScale));
+          c[3] = (c[3] * alphaScale) + (alphaB * (1.0 - alphaScale));
+
+          pixel.write(dp, pixel.merge(c));
+          dp += pixel.stride();
+        }
+      }
+    });
+  });
 }
 
 inline auto image::alphaMultiply() -> void {
   u32 divisor = (1 << _alpha.depth()) - 1;
 
-  for(u32 y = 0; y < _height; y++) {
-    u8* dp = _data + pitch() * y;
-    for(u32 x = 0; x < _width; x++) {
-      u64 color = read(dp);
-
-      u64 colorA = (color & _alpha.mask()) >> _alpha.shift();
-      u64 colorR = (color & _red.mask()  ) >> _red.shift();
-      u64 colorG = (color & _green.mask()) >> _green.shift();
-      u64 colorB = (color & _blue.mask() ) >> _blue.shift();
-
-      colorR = (colorR * colorA) / divisor;
-      colorG = (colorG * colorA) / divisor;
-      colorB = (colorB * colorA) / divisor;
-
-      write(dp, (colorA << _alpha.shift()) | (colorR << _red.shift()) | (colorG << _green.shift()) | (colorB << _blue.shift()));
-      dp += stride();
-    }
-  }
+  dispatch([&](auto pixel) {
+    bands(_height, pitch(), (u64)_width * _height, [&](u32 first, u32 last) {
+      for(u32 y = first; y < last; y++) {
+        u8* dp = _data + pitch() * y;
+        if constexpr(decltype(pixel)::Alpha8888) {
+          alphaMultiply8888(dp, _width);
+          continue;
+        }
+
+        for(u32 x = 0; x < _width; x++) {
+          u64 c[4];
+          pixel.split(c, pixel.read(dp));
+
+          c[1] = (c[1] * c[0]) / divisor;
+          c[2] = (c[2] * c[0]) / divisor;
+          c[3] = (c[3] * c[0]) / divisor;
+
+          pixel.write(dp, pixel.merge(c));
+          dp += pixel.stride();
+        }
+      }
+    });
+  });
 }
 
 inline auto image::transform(const image& source) -> void {
@@ -151,27 +154,44 @@ inline auto image::transform(bool outputEndian, u32 outputDepth, u64 outputAlpha
   image output(outputEndian, outputDepth, outputAlphaMask, outputRedMask, outputGreenMask, outputBlueMask);
   output.allocate(_width, _height);
 
-  for(u32 y = 0; y < _height; y++) {
-    const u8* sp = _data + pitch() * y;
-    u8* dp = output._data + output.pitch() * y;
-    for(u32 x = 0; x < _width; x++) {
-      u64 color = read(sp);
-      sp += stride();
-
-      u64 a = (color & _alpha.mask()) >> _alpha.shift();
-      u64 r = (color & _red.mask()  ) >> _red.shift();
-      u64 g = (color & _green.mask()) >> _green.shift();
-      u64 b = (color & _blue.mask() ) >> _blue.shift();
-
-      a = normalize(a, _alpha.depth(), output._alpha.depth());
-      r = normalize(r, _red.depth(),   output._red.depth());
-      g = normalize(g, _green.depth(), output._green.depth());
-      b = normalize(b, _blue.depth(),  output._blue.depth());
-
-      output.write(dp, (a << output._alpha.shift()) | (r << output._red.shift()) | (g << output._green.shift()) | (b << output._blue.shift()));
-      dp += output.stride();
-    }
-  }
+  dispatch([&](auto input) {
+    output.dispatch([&](auto pixel) {
+      using I = decltype(input);
+      using O = decltype(pixel);
+      bands(_height, output.pitch(), (u64)_width * _height, [&](u32 first, u32 last) {
+        for(u32 y = first; y < last; y++) {
+          const u8* sp = _data + pitch() * y;
+          u8* dp = output._data + output.pitch() * y;
+          if constexpr((is_same_v<I, ARGB8888> && is_same_v<O, ABGR8888>) || (is_same_v<I, ABGR8888> && is_same_v<O, ARGB8888>)) {
+            swap8888(dp, sp, _width);
+            continue;
+          }
+          if constexpr(is_same_v<I, ARGB8888> && is_same_v<O, RGB565>) {
+            pack565(dp, sp, _width);
+            continue;
+          }
+          if constexpr(is_same_v<I, RGB565> && is_same_v<O, ARGB8888>) {
+            unpack565(dp, sp, _width);
+            continue;
+          }
+
+          for(u32 x = 0; x < _width; x++) {
+            u64 c[4];
+            input.split(c, input.read(sp));
+            sp += input.stride();
+
+            c[0] = normalize(c[0], _alpha.depth(), output._alpha.depth());
+            c[1] = normalize(c[1], _red.depth(),   output._red.depth());
+            c[2] = normalize(c[2], _green.depth(), output._green.depth());
+            c[3] = normalize(c[3], _blue.depth(),  output._blue.depth());
+
+            pixel.write(dp, pixel.merge(c));
+            dp += pixel.stride();
+          }
+        }
+      });
+    });
+  });
 
   operator=(move(output));
 }
@@ -4,36 +4,49 @@
 //many thanks to Screwtape for the thorough explanation of this algorithm
 //this implementation would not be possible without his help
 
+//working memory is kept to the suffix array itself plus one bit per character:
+//LMS-substring names and the reduced string for the recursion are stored in the unused half of the suffix array.
+//bucket counting and LMS-substring comparisons are split across threads, but the L and S induction passes still run on one:
+//block-parallel induction (as in libsais) is not implemented, so those passes bound construction time on large inputs.
+
+#include <nall/parallel.hpp>
+
 namespace nall {
 
 //note that induced_sort will return an array of size+1 characters,
 //where the first character is the empty suffix, equal to size
 
+//if workspace is not null, it receives the peak number of bytes allocated during construction (including the result)
+
 template<typename T>
-inline auto induced_sort(array_view<T> data, const u32 characters = 256) -> vector<s32> {
+inline auto induced_sort(array_view<T> data, const u32 characters = 256, u64* workspace = nullptr) -> vector<s32> {
   const u32 size = data.size();
+  if(workspace) *workspace = 0;
   if(size == 0) return vector<s32>{0};  //required to avoid out-of-bounds accesses
   if(size == 1) return vector<s32>{1, 0};  //not strictly necessary; but more performant
 
-  vector<bool> types;  //0 = S-suffix (sort before next suffix), 1 = L-suffix (sort after next suffix)
-  types.resize(size + 1);
+  //work is only split across threads when there is enough of it
+  const u32 chunkSize = 1 << 20;
+  const u32 chunks = (size + chunkSize - 1) / chunkSize;
 
-  types[size - 0] = 0;  //empty suffix is always S-suffix
-  types[size - 1] = 1;  //last suffix is always L-suffix compared to empty suffix
+  //0 = S-suffix (sort before next suffix), 1 = L-suffix (sort after next suffix); one bit per suffix
+  vector<u64> types;
+  types.resize((size + 1 + 63) / 64);
+  auto type = [&](u32 n) -> bool { return types[n >> 6] >> (n & 63) & 1; };
+  auto setL = [&](u32 n) { types[n >> 6] |= 1ull << (n & 63); };
+
+  //empty suffix is always S-suffix
+  setL(size - 1);  //last suffix is always L-suffix compared to empty suffix
+  bool next = 1;
   for(u32 n : reverse(range(size - 1))) {
-    if(data[n] < data[n + 1]) {
-      types[n] = 0;  //this suffix is smaller than the one after it
-    } else if(data[n] > data[n + 1]) {
-      types[n] = 1;  //this suffix is larger than the one after it
-    } else {
-      types[n] = types[n + 1];  //this suffix will be the same as the one after it
-    }
+    if(data[n] != data[n + 1]) next = data[n] > data[n + 1];  //larger than the suffix after it: L-suffix
+    if(next) setL(n);  //equal characters take the type of the suffix after them
   }
 
   //left-most S-suffix
   auto isLMS = [&](s32 n) -> bool {
     if(n == 0) return 0;  //no character to the left of the first suffix
-    return !types[n] && types[n - 1];  //true if this is the start of a new S-suffix
+    return !type(n) && type(n - 1);  //true if this is the start of a new S-suffix
   };
 
   //test if two LMS-substrings are equal
@@ -52,7 +65,19 @@ inline auto induced_sort(array_view<T> data, const u32 characters = 256) -> vect
   //determine the sizes of each bucket: one bucket per character
   vector<u32> counts;
   counts.resize(characters);
-  for(u32 n : range(size)) counts[data[n]]++;
+  if(chunks > 1 && characters <= 65536) {
+    vector<u32> partials;
+    partials.resize(chunks * characters);
+    parallel::run(chunks, [&](u32 chunk) {
+      u32* partial = partials.data() + chunk * characters;
+      for(u32 n : range(chunk * chunkSize, min(size, (chunk + 1) * chunkSize))) partial[data[n]]++;
+    });
+    for(u32 chunk : range(chunks)) {
+      for(u32 c : range(characters)) counts[c] += partials[chunk * characters + c];
+    }
+  } else {
+    for(u32 n : range(size)) counts[data[n]]++;
+  }
 
   //bucket sorting start offsets
   vector<u32> heads;
@@ -92,13 +117,24 @@ inline auto induced_sort(array_view<T> data, const u32 characters = 256) -> vect
 
   suffixes[0] = size;  //the empty suffix is always an LMS-suffix, and is the first suffix
 
+  //the induction passes are bound by memory latency: fetch the character and type of suffixes a little ahead of use
+  const u32 lookahead = 32;
+  auto prefetch = [&](s32 suffix) {
+    if(suffix <= 0) return;
+    #if defined(COMPILER_CLANG) || defined(COMPILER_GCC)
+    __builtin_prefetch(&data[suffix - 1]);
+    __builtin_prefetch(&types[suffix - 1 >> 6]);
+    #endif
+  };
+
   //sort all L-suffixes to the left of LMS-suffixes
   auto sortL = [&] {
     getHeads();
     for(u32 n : range(size + 1)) {
+      if(n + lookahead <= size) prefetch(suffixes[n + lookahead]);
       if(suffixes[n] == -1) continue;  //offsets may not be known yet here ...
       auto l = suffixes[n] - 1;
-      if(l < 0 || !types[l]) continue;  //skip S-suffixes
+      if(l < 0 || !type(l)) continue;  //skip S-suffixes
       suffixes[heads[data[l]]++] = l;  //advance from the head of the bucket
     }
   };
@@ -106,8 +142,9 @@ inline auto induced_sort(array_view<T> data, const u32 characters = 256) -> vect
   auto sortS = [&] {
     getTails();
     for(u32 n : reverse(range(size + 1))) {
+      if(n >= lookahead) prefetch(suffixes[n - lookahead]);
       auto l = suffixes[n] - 1;
-      if(l < 0 || types[l]) continue;  //skip L-suffixes
+      if(l < 0 || type(l)) continue;  //skip L-suffixes
       suffixes[tails[data[l]]--] = l;  //advance from the tail of the bucket
     }
   };
@@ -115,54 +152,69 @@ inline auto induced_sort(array_view<T> data, const u32 characters = 256) -> vect
   sortL();
   sortS();
 
-  //analyze data for the summary suffix array
-  vector<s32> names;
-  names.resize(size + 1, (s32)-1);
-
-  u32 currentName = 0;  //keep a count to tag each unique LMS-substring with unique IDs
-  auto lastLMSOffset = suffixes[0];  //location in the original data of the last checked LMS suffix
-  names[lastLMSOffset] = currentName;  //the first LMS-substring is always the empty suffix entry, at position 0
+  //gather the LMS-suffixes, now sorted by their LMS-substrings, at the front of the array
+  u32 lmsCount = 0;
+  for(u32 n : range(size + 1)) {
+    if(isLMS(suffixes[n])) suffixes[lmsCount++] = suffixes[n];
+  }
 
-  for(u32 n : range(1, size + 1)) {
-    auto offset = suffixes[n];
-    if(!isLMS(offset)) continue;  //only LMS suffixes are important
+  //LMS-suffixes are at least two characters apart, so their names fit in the back half of the array, indexed by offset / 2
+  s32* names = suffixes.data() + lmsCount;
+  for(u32 n : range(lmsCount, size + 1)) suffixes[n] = -1;
 
-    //if this LMS suffix starts with a different LMS substring than the last suffix observed ...
-    if(!isEqual(lastLMSOffset, offset)) currentName++;  //then it gets a new name
-    lastLMSOffset = offset;  //keep track of the new most-recent LMS suffix
-    names[lastLMSOffset] = currentName;  //store the LMS suffix name where the suffix appears at in the original data
+  //first mark which LMS-substrings differ from the one sorted before them ...
+  u32 lmsChunks = (lmsCount + chunkSize - 1) / chunkSize;
+  parallel::run(lmsChunks, [&](u32 chunk) {
+    for(u32 n : range(max(1u, chunk * chunkSize), min(lmsCount, (chunk + 1) * chunkSize))) {
+      names[suffixes[n] >> 1] = !isEqual(suffixes[n - 1], suffixes[n]);
+    }
+  });
+
+  //... then give each unique LMS-substring an increasing name
+  u32 currentName = 0;  //the first LMS-substring is always the empty suffix entry, at position 0
+  names[suffixes[0] >> 1] = currentName;
+  for(u32 n : range(1, lmsCount)) {
+    s32& name = names[suffixes[n] >> 1];
+    currentName += name;
+    name = currentName;
   }
+  u32 summaryCharacters = currentName + 1;  //zero-indexed, so the total unique characters is currentName + 1
 
-  vector<s32> summaryOffsets;
-  vector<s32> summaryData;
-  for(u32 n : range(size + 1)) {
-    if(names[n] == -1) continue;
-    summaryOffsets.append(n);
-    summaryData.append(names[n]);
+  //the summary string is the names in the order the LMS-suffixes appear in the data; pack it at the very end
+  s32* summaryData = suffixes.data() + size + 1 - lmsCount;
+  for(u32 n = size + 1, m = size + 1; n > lmsCount;) {
+    if(suffixes[--n] >= 0) suffixes[--m] = suffixes[n];
   }
-  u32 summaryCharacters = currentName + 1;  //zero-indexed, so the total unique characters is currentName + 1
 
   //make the summary suffix array
+  u64 recursion = 0;
   vector<s32> summaries;
-  if(summaryData.size() == summaryCharacters) {
+  if(lmsCount == summaryCharacters) {
     //simple bucket sort when every character in summaryData appears only once
-    summaries.resize(summaryData.size() + 1, (s32)-1);
-    summaries[0] = summaryData.size();  //always include the empty suffix at the beginning
-    for(s32 x : range(summaryData.size())) {
+    summaries.resize(lmsCount + 1, (s32)-1);
+    summaries[0] = lmsCount;  //always include the empty suffix at the beginning
+    for(s32 x : range(lmsCount)) {
       s32 y = summaryData[x];
       summaries[y + 1] = x;
     }
   } else {
     //recurse until every character in summaryData is unique ...
-    summaries = induced_sort<s32>({summaryData.data(), summaryData.size()}, summaryCharacters);
+    summaries = induced_sort<s32>({summaryData, lmsCount}, summaryCharacters, workspace ? &recursion : nullptr);
   }
 
+  //the summary string is no longer needed: replace it with the offset of each LMS-suffix
+  s32* summaryOffsets = summaryData;
+  for(u32 n = 0, m = 0; n < size + 1; n++) {
+    if(isLMS(n)) summaryOffsets[m++] = n;
+  }
+  for(u32 n : range(2, summaries.size())) summaries[n] = summaryOffsets[summaries[n]];
+
   suffixes.fill(-1);  //reuse existing buffer for accurate sort
 
   //accurate LMS sort
   getTails();
   for(u32 n : reverse(range(2, summaries.size()))) {
-    auto index = summaryOffsets[summaries[n]];
+    auto index = summaries[n];
     suffixes[tails[data[index]]--] = index;  //advance from the tail of the bucket
   }
   suffixes[0] = size;  //always include the empty suffix at the beginning
@@ -170,6 +222,11 @@ inline auto induced_sort(array_view<T> data, const u32 characters = 256) -> vect
   sortL();
   sortS();
 
+  if(workspace) {
+    *workspace = suffixes.capacity() * sizeof(s32) + types.capacity() * sizeof(u64)
+               + (counts.capacity() + heads.capacity() + tails.capacity()) * sizeof(u32)
+               + max<u64>(summaries.capacity() * sizeof(s32), recursion);
+  }
   return suffixes;
 }
 
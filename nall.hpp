@@ -40,9 +40,11 @@
 #include <nall/maybe.hpp>
 #include <nall/memory.hpp>
 #include <nall/merge-sort.hpp>
+#include <nall/parallel.hpp>
 #include <nall/path.hpp>
 #include <nall/pointer.hpp>
 #include <nall/primitives.hpp>
+#include <nall/pairing-heap.hpp>
 #include <nall/priority-queue.hpp>
 #include <nall/queue.hpp>
 #include <nall/random.hpp>
@@ -78,6 +80,7 @@
 #include <nall/encode/html.hpp>
 #include <nall/encode/url.hpp>
 #include <nall/encode/zip.hpp>
+#include <nall/hash/adler32.hpp>
 #include <nall/hash/crc16.hpp>
 #include <nall/hash/crc32.hpp>
 #include <nall/hash/crc64.hpp>
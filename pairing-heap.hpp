@@ -0,0 +1,192 @@
+#pragma once
+
+//priority queue implementation using a pairing heap over a fixed pool of nodes:
+//O(1)     find
+//O(1)     insert
+//O(log n) remove(first)  (amortized)
+//O(log n) cancel(handle) (amortized)
+//O(n)     remove(event)
+
+//insert() returns a handle that cancel() uses to remove the event; handles of events that have already
+//been removed are recognized and ignored. the clock semantics match priority_queue, including 32-bit wraparound.
+
+#include <nall/function.hpp>
+#include <nall/maybe.hpp>
+#include <nall/serializer.hpp>
+
+namespace nall {
+
+template<typename T> struct pairing_heap;
+
+template<typename T, u32 Size>
+struct pairing_heap<T[Size]> {
+  static_assert(Size > 0 && Size < 65536, "pairing_heap handles store the node index in 16 bits");
+
+  pairing_heap() {
+    for(auto& node : nodes) node.generation = 0, node.used = false;
+    reset();
+  }
+
+  explicit operator bool() const {
+    return root != Nil;
+  }
+
+  auto reset() -> void {
+    clock = 0;
+    size = 0;
+    root = Nil;
+    free = Nil;
+    for(u32 index : reverse(range(Size))) release(index);
+  }
+
+  template<typename F>
+  auto step(u32 clocks, const F& callback) -> void {
+    clock += clocks;
+    while(root != Nil && ge(clock, nodes[root].clock)) {
+      callback(*remove());
+    }
+  }
+
+  auto insert(const T& event, u32 clock) -> maybe<u32> {
+    if(free == Nil) return nothing;
+    u32 index = free;
+    free = nodes[index].next;
+    size++;
+
+    auto& node = nodes[index];
+    node.clock = this->clock + clock;
+    node.event = event;
+    node.child = Nil;
+    node.next = Nil;
+    node.prev = Nil;
+    node.used = true;
+    root = meld(root, index);
+    return node.generation << 16 | index;
+  }
+
+  auto remove() -> maybe<T> {
+    if(root == Nil) return nothing;
+    u32 index = root;
+    T event = nodes[index].event;
+    root = combine(nodes[index].child);
+    release(index);
+    size--;
+    return event;
+  }
+
+  //cancels a pending event; returns false if it has already been removed
+  auto cancel(u32 handle) -> bool {
+    u32 index = handle & 0xffff;
+    if(index >= Size || nodes[index].generation != handle >> 16 || !nodes[index].used) return false;
+    if(index == root) return remove(), true;
+
+    //detach the subtree from its parent (or previous sibling), then merge its children back in
+    auto& node = nodes[index];
+    if(nodes[node.prev].child == index) {
+      nodes[node.prev].child = node.next;
+    } else {
+      nodes[node.prev].next = node.next;
+    }
+    if(node.next != Nil) nodes[node.next].prev = node.prev;
+    root = meld(root, combine(node.child));
+    release(index);
+    size--;
+    return true;
+  }
+
+  auto remove(const T& event) -> void {
+    for(u32 index : range(Size)) {
+      if(nodes[index].used && nodes[index].event == event) cancel(nodes[index].generation << 16 | index);
+    }
+  }
+
+  auto serialize(serializer& s) -> void {
+    s(clock);
+    s(size);
+    s(root);
+    s(free);
+    for(auto& node : nodes) {
+      s(node.clock);
+      s(node.event);
+      s(node.child);
+      s(node.next);
+      s(node.prev);
+      s(node.generation);
+      s(node.used);
+    }
+  }
+
+private:
+  static constexpr u32 Nil = ~0u;
+
+  //returns true if x is greater than or equal to y
+  auto ge(u32 x, u32 y) -> bool {
+    return x - y < 0x7fffffff;
+  }
+
+  //returns a node to the free list, and invalidates all handles to it
+  auto release(u32 index) -> void {
+    auto& node = nodes[index];
+    node.used = false;
+    node.generation = node.generation + 1 & 0xffff;
+    node.next = free;
+    free = index;
+  }
+
+  //merges two heaps; the root with the later clock becomes the first child of the other
+  auto meld(u32 a, u32 b) -> u32 {
+    if(a == Nil) return b;
+    if(b == Nil) return a;
+    if(!ge(nodes[b].clock, nodes[a].clock)) std::swap(a, b);
+    auto& parent = nodes[a];
+    auto& child = nodes[b];
+    child.prev = a;
+    child.next = parent.child;
+    if(parent.child != Nil) nodes[parent.child].prev = b;
+    parent.child = b;
+    return a;
+  }
+
+  //merges a list of sibling heaps into one: pairs are melded left to right, then the results right to left
+  auto combine(u32 first) -> u32 {
+    if(first == Nil) return Nil;
+    u32 pairs = Nil;
+    while(first != Nil) {
+      u32 a = first;
+      u32 b = nodes[a].next;
+      first = b != Nil ? nodes[b].next : Nil;
+      nodes[a].next = Nil;
+      if(b != Nil) nodes[b].next = Nil;
+      u32 pair = meld(a, b);
+      nodes[pair].next = pairs;
+      pairs = pair;
+    }
+    u32 result = pairs;
+    pairs = nodes[result].next;
+    nodes[result].next = Nil;
+    while(pairs != Nil) {
+      u32 next = nodes[pairs].next;
+      nodes[pairs].next = Nil;
+      result = meld(result, pairs);
+      pairs = next;
+    }
+    nodes[result].prev = Nil;
+    return result;
+  }
+
+  u32 clock = 0;
+  u32 size = 0;
+  u32 root = Nil;
+  u32 free = Nil;
+  struct Node {
+    u32  clock;
+    T    event;
+    u32  child;       //first child
+    u32  next;        //next sibling, or next free node
+    u32  prev;        //previous sibling, or parent for the first child
+    u32  generation;  //incremented whenever the node is released
+    bool used;
+  } nodes[Size];
+};
+
+}
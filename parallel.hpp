@@ -0,0 +1,59 @@
+#pragma once
+
+//fork-join helpers for splitting independent work items across threads
+//the calling thread participates, and run() returns only once every item has completed
+
+#include <nall/thread.hpp>
+
+#include <condition_variable>
+#include <thread>
+
+namespace nall::parallel {
+
+//number of hardware threads available; always at least one
+inline auto concurrency() -> u32 {
+  static const u32 count = max(1u, std::thread::hardware_concurrency());
+  return count;
+}
+
+//invokes callback(index) once for each index in [0, count), using up to `threads` threads (0 = concurrency())
+//items are handed out in order from a shared counter, so uneven item costs balance out automatically
+template<typename F> inline auto run(u32 count, const F& callback, u32 threads = 0) -> void {
+  if(threads == 0) threads = concurrency();
+  threads = min(threads, count);
+  if(threads <= 1) {
+    for(u32 index : range(count)) callback(index);
+    return;
+  }
+
+  struct State {
+    atomic<u32> next = 0;
+    u32 active = 0;
+    std::mutex lock;
+    std::condition_variable finished;
+  } state;
+
+  auto work = [&] {
+    while(true) {
+      u32 index = state.next++;
+      if(index >= count) break;
+      callback(index);
+    }
+  };
+
+  state.active = threads - 1;
+  for(u32 worker = 1; worker < threads; worker++) {
+    thread::create([&](uintptr) {
+      thread::detach();
+      work();
+      lock_guard<std::mutex> guard{state.lock};
+      if(--state.active == 0) state.finished.notify_one();
+    });
+  }
+
+  work();
+  std::unique_lock<std::mutex> guard{state.lock};
+  state.finished.wait(guard, [&] { return state.active == 0; });
+}
+
+}
@@ -2,3 +2,4 @@
 #include <nall/serializer.hpp>
 #include <nall/queue/st.hpp>
 #include <nall/queue/spsc.hpp>
+#include <nall/queue/mpmc.hpp>
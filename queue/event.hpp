@@ -0,0 +1,69 @@
+#pragma once
+
+//blocking wait/notify used by the lockless queues in place of pure spin-loops
+//waiters spin briefly, and then sleep on a futex (or std::atomic<T>::wait) until notified;
+//notify() costs a fence and a load while nobody is waiting
+
+#include <nall/thread.hpp>
+
+#if defined(PLATFORM_LINUX) && __has_include(<linux/futex.h>)
+  #include <linux/futex.h>
+  #include <sys/syscall.h>
+  #include <unistd.h>
+  #define NALL_QUEUE_FUTEX
+#endif
+
+namespace nall {
+
+struct queue_event {
+  //returns once ready() is true; ready() is retried after every wakeup, and may also perform the awaited operation
+  template<typename F> auto await(const F& ready) -> void {
+    for(u32 attempt : range(64)) {
+      if(ready()) return;
+      spinloop();
+    }
+    while(true) {
+      u32 epoch = _epoch.load();
+      _waiters++;
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      if(ready()) { _waiters--; return; }
+      sleep(epoch);
+      _waiters--;
+    }
+  }
+
+  //wakes all waiters; call after the state that ready() observes has been published
+  auto notify() -> void {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if(!_waiters.load(std::memory_order_relaxed)) return;
+    _epoch++;
+    wake();
+  }
+
+private:
+  auto sleep(u32 epoch) -> void {
+    #if defined(__cpp_lib_atomic_wait)
+    _epoch.wait(epoch);
+    #elif defined(NALL_QUEUE_FUTEX)
+    static_assert(sizeof(atomic<u32>) == sizeof(u32));
+    syscall(SYS_futex, (u32*)&_epoch, FUTEX_WAIT_PRIVATE, epoch, nullptr, nullptr, 0);
+    #else
+    while(_epoch.load() == epoch) usleep(50);
+    #endif
+  }
+
+  auto wake() -> void {
+    #if defined(__cpp_lib_atomic_wait)
+    _epoch.notify_all();
+    #elif defined(NALL_QUEUE_FUTEX)
+    syscall(SYS_futex, (u32*)&_epoch, FUTEX_WAKE_PRIVATE, INT_MAX, nullptr, nullptr, 0);
+    #endif
+  }
+
+  atomic<u32> _epoch = 0;
+  atomic<u32> _waiters = 0;
+};
+
+}
+
+#undef NALL_QUEUE_FUTEX
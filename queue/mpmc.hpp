@@ -0,0 +1,143 @@
+#pragma once
+
+//multi-producer, multi-consumer bounded lockless queue
+//each cell carries a sequence number that tells producers and consumers whose turn it is (after Dmitry Vyukov's design);
+//the read and write positions live on their own cache lines, and the await functions sleep rather than spin indefinitely
+
+#include <nall/queue/event.hpp>
+
+namespace nall {
+
+template<typename T> struct queue_mpmc;
+
+template<typename T, u32 Size>
+struct queue_mpmc<T[Size]> {
+  static_assert(Size >= 2 && (Size & Size - 1) == 0, "queue_mpmc size must be a power of two");
+
+  queue_mpmc() {
+    for(u32 n : range(Size)) _cells[n].sequence.store(n, std::memory_order_relaxed);
+  }
+
+  //only a snapshot while other threads are active
+  auto size() const -> u32 {
+    s32 size = _write.load(std::memory_order_acquire) - _read.load(std::memory_order_acquire);
+    return max(0, min((s32)Size, size));
+  }
+
+  auto capacity() const -> u32 {
+    return Size;
+  }
+
+  auto empty() const -> bool {
+    return size() == 0;
+  }
+
+  auto full() const -> bool {
+    return size() == Size;
+  }
+
+  auto read() -> maybe<T> {
+    T value;
+    if(!read({&value, 1})) return nothing;
+    return value;
+  }
+
+  auto write(const T& value) -> bool {
+    return write({&value, 1}) == 1;
+  }
+
+  //reads up to values.size() consecutive values; returns the number read
+  auto read(array_span<T> values) -> u32 {
+    u32 position;
+    u32 count = claim(_read, position, values.size(), 1);
+    if(!count) return 0;
+    for(u32 n : range(count)) {
+      auto& cell = _cells[position + n & Size - 1];
+      values[n] = move(cell.value);
+      cell.sequence.store(position + n + Size, std::memory_order_release);
+    }
+    _writable.notify();
+    return count;
+  }
+
+  //writes as many consecutive values as there is room for; returns the number written
+  auto write(array_view<T> values) -> u32 {
+    u32 position;
+    u32 count = claim(_write, position, values.size(), 0);
+    if(!count) return 0;
+    for(u32 n : range(count)) {
+      auto& cell = _cells[position + n & Size - 1];
+      cell.value = values[n];
+      cell.sequence.store(position + n + 1, std::memory_order_release);
+    }
+    _readable.notify();
+    return count;
+  }
+
+  auto await_empty() -> void {
+    _writable.await([&] { return empty(); });
+  }
+
+  auto await_read() -> T {
+    maybe<T> value;
+    _readable.await([&] { return (bool)(value = read()); });
+    return value();
+  }
+
+  auto await_write(const T& value) -> void {
+    _writable.await([&] { return write(value); });
+  }
+
+  //blocks until every value has been read into values
+  auto await_read(array_span<T> values) -> void {
+    u32 offset = 0;
+    _readable.await([&] {
+      offset += read({values.data() + offset, values.size() - offset});
+      return offset == values.size();
+    });
+  }
+
+  //blocks until every value has been written
+  auto await_write(array_view<T> values) -> void {
+    u32 offset = 0;
+    _writable.await([&] {
+      offset += write({values.data() + offset, values.size() - offset});
+      return offset == values.size();
+    });
+  }
+
+private:
+  //reserves up to count consecutive cells starting at position, returning how many were reserved;
+  //a cell is ready when its sequence equals position + ahead (0 = free for a writer, 1 = filled for a reader)
+  auto claim(atomic<u32>& index, u32& position, u32 count, u32 ahead) -> u32 {
+    position = index.load(std::memory_order_relaxed);
+    while(true) {
+      u32 ready = 0;
+      while(ready < count) {
+        u32 sequence = _cells[position + ready & Size - 1].sequence.load(std::memory_order_acquire);
+        s32 difference = sequence - (position + ready + ahead);
+        if(difference != 0) {
+          //another thread claimed this position first: start over from the new position
+          if(difference > 0 && ready == 0) { position = index.load(std::memory_order_relaxed); continue; }
+          break;
+        }
+        ready++;
+      }
+      if(ready == 0) return 0;
+      if(index.compare_exchange_weak(position, position + ready, std::memory_order_relaxed)) return ready;
+    }
+  }
+
+  struct Cell {
+    atomic<u32> sequence;
+    T value;
+  };
+
+  alignas(64) atomic<u32> _write = 0;
+  alignas(64) atomic<u32> _read = 0;
+  alignas(64) queue_event _readable;
+  alignas(64) queue_event _writable;
+  alignas(64) Cell _cells[Size];
+};
+
+}
@@ -3,6 +3,10 @@
 //single-producer, single-consumer lockless queue
 //includes await functions for spin-loops
 
+//the read and write positions live on separate cache lines, and each side keeps a private copy of the other side's position,
+//so that the shared positions are only re-read when the copy suggests the queue is empty (or full)
+//positions run freely and are masked when Size is a power of two; otherwise they wrap at 2 * Size
+
 namespace nall {
 
 template<typename T> struct queue_spsc;
@@ -11,11 +15,17 @@ template<typename T, u32 Size>
 struct queue_spsc<T[Size]> {
   auto flush() -> void {
     _read  = 0;
-    _write = 2 * Size;
+    _write = 0;
+    _readCache  = 0;
+    _writeCache = 0;
   }
 
   auto size() const -> u32 {
-    return (_write - _read) % (2 * Size);
+    return distance(_write.load(std::memory_order_acquire), _read.load(std::memory_order_acquire));
+  }
+
+  auto capacity() const -> u32 {
+    return Size;
   }
 
   auto empty() const -> bool {
@@ -27,40 +37,106 @@ struct queue_spsc<T[Size]> {
   }
 
   auto read() -> maybe<T> {
-    if(empty()) return nothing;
-    auto value = _data[_read % Size];
-    _read = _read + 1 < 2 * Size ? _read + 1 : 0;
+    u32 read = _read.load(std::memory_order_relaxed);
+    if(!readable(read, 1)) return nothing;
+    auto value = _data[slot(read)];
+    _read.store(advance(read, 1), std::memory_order_release);
     return value;
   }
 
   auto write(const T& value) -> bool {
-    if(full()) return false;
-    _data[_write % Size] = value;
-    _write = _write + 1 < 4 * Size ? _write + 1 : 2 * Size;
+    u32 write = _write.load(std::memory_order_relaxed);
+    if(!writable(write, 1)) return false;
+    _data[slot(write)] = value;
+    _write.store(advance(write, 1), std::memory_order_release);
     return true;
   }
 
+  //reads up to values.size() values; returns the number read
+  auto read(array_span<T> values) -> u32 {
+    u32 read = _read.load(std::memory_order_relaxed);
+    u32 count = min((u32)values.size(), readable(read, values.size()));
+    if(!count) return 0;
+    u32 first = min(count, Size - slot(read));
+    copy(values.data(), _data + slot(read), first);
+    copy(values.data() + first, _data, count - first);
+    _read.store(advance(read, count), std::memory_order_release);
+    return count;
+  }
+
+  //writes as many values as there is room for; returns the number written
+  auto write(array_view<T> values) -> u32 {
+    u32 write = _write.load(std::memory_order_relaxed);
+    u32 count = min((u32)values.size(), writable(write, values.size()));
+    if(!count) return 0;
+    u32 first = min(count, Size - slot(write));
+    copy(_data + slot(write), values.data(), first);
+    copy(_data, values.data() + first, count - first);
+    _write.store(advance(write, count), std::memory_order_release);
+    return count;
+  }
+
   auto await_empty() -> void {
     while(!empty()) spinloop();
   }
 
   auto await_read() -> T {
-    while(empty()) spinloop();
-    auto value = _data[_read % Size];
-    _read = _read + 1 < 2 * Size ? _read + 1 : 0;
-    return value;
+    while(true) {
+      if(auto value = read()) return value();
+      spinloop();
+    }
   }
 
   auto await_write(const T& value) -> void {
-    while(full()) spinloop();
-    _data[_write % Size] = value;
-    _write = _write + 1 < 4 * Size ? _write + 1 : 2 * Size;
+    while(!write(value)) spinloop();
   }
 
 private:
-  T _data[Size];
-  std::atomic<u32> _read  = 0;
-  std::atomic<u32> _write = 2 * Size;
+  static constexpr bool PowerOfTwo = (Size & Size - 1) == 0;
+
+  static auto advance(u32 position, u32 count) -> u32 {
+    if constexpr(PowerOfTwo) return position + count;
+    position += count;
+    return position >= 2 * Size ? position - 2 * Size : position;
+  }
+
+  static auto distance(u32 write, u32 read) -> u32 {
+    if constexpr(PowerOfTwo) return write - read;
+    return write >= read ? write - read : write + 2 * Size - read;
+  }
+
+  static auto slot(u32 position) -> u32 {
+    if constexpr(PowerOfTwo) return position & Size - 1;
+    return position < Size ? position : position - Size;
+  }
+
+  static auto copy(T* target, const T* source, u32 count) -> void {
+    if constexpr(std::is_trivially_copyable_v<T>) {
+      if(count) memcpy(target, source, count * sizeof(T));
+    } else {
+      for(u32 n : range(count)) target[n] = source[n];
+    }
+  }
+
+  //consumer side: returns the number of values available; the shared position is only re-read when the copy shows fewer than wanted
+  auto readable(u32 read, u32 wanted) -> u32 {
+    u32 available = distance(_writeCache, read);
+    if(available < wanted) available = distance(_writeCache = _write.load(std::memory_order_acquire), read);
+    return available;
+  }
+
+  //producer side: returns the number of free slots; the shared position is only re-read when the copy shows fewer than wanted
+  auto writable(u32 write, u32 wanted) -> u32 {
+    u32 available = Size - distance(write, _readCache);
+    if(available < wanted) available = Size - distance(write, _readCache = _read.load(std::memory_order_acquire));
+    return available;
+  }
+
+  alignas(64) std::atomic<u32> _read  = 0;
+  alignas(64) u32 _writeCache = 0;  //consumer's copy of _write
+  alignas(64) std::atomic<u32> _write = 0;
+  alignas(64) u32 _readCache  = 0;  //producer's copy of _read
+  alignas(64) T _data[Size];
 };
 
 }
@@ -92,8 +92,8 @@ suffix_array_lpf:
 
 // suffix array via induced sorting
 // O(n)
-inline auto suffix_array(array_view<u8> input) -> vector<s32> {
-  return induced_sort(input);
+inline auto suffix_array(array_view<u8> input, u64* workspace = nullptr) -> vector<s32> {
+  return induced_sort(input, 256, workspace);
 }
 
 // inverse
@@ -329,7 +329,7 @@ struct SuffixArray {
 
   //O(n)
   SuffixArray(array_view<u8> input) : input(input) {
-    sa = suffix_array(input);
+    sa = suffix_array(input, &workspace);
   }
 
   //O(n)
@@ -368,6 +368,15 @@ struct SuffixArray {
     offset = offsets[address];
   }
 
+  //bytes currently held by the suffix array and its auxiliary data structures
+  auto memory() const -> u64 {
+    u64 bytes = 0;
+    for(auto array : {&sa, &isa, &phi, &plcp, &lcp, &llcp, &rlcp, &lengths, &offsets}) {
+      bytes += array->capacity() * sizeof(s32);
+    }
+    return bytes;
+  }
+
   //non-owning reference: SuffixArray is invalidated if memory is freed
   array_view<u8> input;
 
@@ -381,6 +390,8 @@ struct SuffixArray {
   vector<s32> rlcp;     //longest common prefixes - right
   vector<s32> lengths;  //longest previous factors
   vector<s32> offsets;  //longest previous factors
+
+  u64 workspace = 0;    //peak bytes allocated while constructing the suffix array
 };
 
 }
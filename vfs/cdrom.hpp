@@ -3,23 +3,31 @@
 #include <nall/array-span.hpp>
 #include <nall/cd.hpp>
 #include <nall/file.hpp>
+#include <nall/file-map.hpp>
+#include <nall/parallel.hpp>
 #include <nall/string.hpp>
 #include <nall/decode/cue.hpp>
 #include <nall/decode/wav.hpp>
 
 namespace nall::vfs {
 
+//by default, the entire disc image (including lead-in and lead-out) is built in memory when opened, using every hardware thread
+//lazy images instead synthesize sectors on first access from memory-mapped track files,
+//and keep the most recently used blocks of sectors in a fixed-size cache
+//raw 2352-byte sectors need no synthesis, and are read straight from the mapping (and thus the page cache)
+//lazy images have no contiguous data() and ignore writes
+
 struct cdrom : file {
-  static auto open(const string& cueLocation) -> shared_pointer<cdrom> {
+  static auto open(const string& cueLocation, bool lazy = false) -> shared_pointer<cdrom> {
     auto instance = shared_pointer<cdrom>{new cdrom};
-    if(instance->load(cueLocation)) return instance;
+    if(instance->load(cueLocation, lazy)) return instance;
     return {};
   }
 
   auto writable() const -> bool override { return false; }
   auto data() const -> const u8* override { return _image.data(); }
   auto data() -> u8* override { return _image.data(); }
-  auto size() const -> u64 override { return _image.size(); }
+  auto size() const -> u64 override { return _size; }
   auto offset() const -> u64 override { return _offset; }
 
   auto resize(u64 size) -> bool override {
@@ -33,8 +41,10 @@ struct cdrom : file {
   }
 
   auto read() -> u8 override {
-    if(_offset >= _image.size()) return 0x00;
-    return _image[_offset++];
+    if(_offset >= _size) return 0x00;
+    if(_image) return _image[_offset++];
+    if(_offset - _windowOffset >= _windowLength) window(_offset);
+    return _window[_offset++ - _windowOffset];
   }
 
   auto write(u8 data) -> void override {
@@ -43,8 +53,57 @@ struct cdrom : file {
     _image[_offset++] = data;
   }
 
+  auto read(array_span<u8> span) -> void override {
+    u8* target = span.data();
+    u64 length = _offset < _size ? min(span.size(), _size - _offset) : 0;
+    memset(target + length, 0x00, span.size() - length);
+    if(_image) {
+      if(length) memcpy(target, _image.data() + _offset, length);
+      _offset += length;
+      return;
+    }
+    while(length) {
+      if(_offset - _windowOffset >= _windowLength) window(_offset);
+      u64 index = _offset - _windowOffset;
+      u64 chunk = min(length, _windowLength - index);
+      memcpy(target, _window + index, chunk);
+      target += chunk;
+      _offset += chunk;
+      length -= chunk;
+    }
+  }
+
+  auto write(array_view<u8> view) -> void override {
+    u64 length = _offset < _image.size() ? min(view.size(), _image.size() - _offset) : 0;
+    if(length) memcpy(_image.data() + _offset, view.data(), length);
+    _offset += length;
+  }
+
+  auto advise(u32 hint) -> bool override {
+    if(_image) return adviseHeap(_image.data(), _image.size(), hint);
+    bool result = false;
+    for(auto& fp : _files) result |= fp.advise(hint);
+    return result;
+  }
+
 private:
-  auto load(const string& cueLocation) -> bool {
+  //a contiguous run of sectors stored in one track file
+  struct Extent {
+    s32 lba;
+    u32 sectors;
+    u32 sectorSize;  //2048 (ISO) or 2352 (BIN, WAV)
+    u32 file;
+    u64 offset;
+  };
+
+  //one cache slot of the lazy image; slots form a doubly-linked list in most recently used order
+  struct Slot {
+    u32 block = ~0;
+    u32 previous = ~0;
+    u32 next = ~0;
+  };
+
+  auto load(const string& cueLocation, bool lazy) -> bool {
     Decode::CUE cuesheet;
     if(!cuesheet.load(cueLocation)) return false;
 
@@ -93,64 +152,191 @@ private:
     session.tracks[1].indices[0].lba = 0;  //track 1, index 0 is not present in CUE files
     session.tracks[1].indices[0].end = Track1Pregap - 1;
 
-    _image.resize(2448 * (LeadInSectors + endDisc + LeadOutSectors));
+    _sectors = LeadInSectors + endDisc + LeadOutSectors;
+    _size = 2448ull * _sectors;
 
     lbaDisc = Track1Pregap;
     for(auto& file : cuesheet.files) {
-      auto location = string{Location::path(cueLocation), file.name};
-      auto filedata = nall::file::open(location, nall::file::mode::read);
-      if(file.type == "wave") filedata.seek(44);  //skip RIFF header
-      u64 offset = 0;
+      u64 offset = file.type == "wave" ? 44 : 0;  //skip RIFF header
       for(auto& track : file.tracks) {
+        auto length = track.sectorSize();
+        if(length != 2048 && length != 2352) continue;
         for(auto& index : track.indices) {
-          for(s32 sector : range(index.sectorCount())) {
-            auto target = _image.data() + 2448ull * (LeadInSectors + lbaDisc + index.lba + sector);
-            auto length = track.sectorSize();
-            if(length == 2048) {
-              //ISO: generate header + parity data
-              memory::assign(target + 0, 0x00, 0xff, 0xff, 0xff, 0xff, 0xff);  //sync
-              memory::assign(target + 6, 0xff, 0xff, 0xff, 0xff, 0xff, 0x00);  //sync
-              auto [minute, second, frame] = CD::MSF(lbaDisc + index.lba + sector);
-              target[12] = CD::BCD::encode(minute);
-              target[13] = CD::BCD::encode(second);
-              target[14] = CD::BCD::encode(frame);
-              target[15] = 0x01;  //mode
-              filedata.read({target + 16, length});
-              CD::RSPC::encodeMode1({target, 2352});
-            }
-            if(length == 2352) {
-              //BIN + WAV: direct copy
-              filedata.read({target, length});
-            }
-          }
+          if(!index.sectorCount()) continue;
+          _extents.append({lbaDisc + index.lba, index.sectorCount(), length, (u32)_locations.size(), offset});
+          offset += (u64)length * index.sectorCount();
         }
-        offset += track.sectorSize() * track.sectorCount();
       }
+      _locations.append({Location::path(cueLocation), file.name});
       lbaDisc += file.tracks.last().indices.last().end + 1;
     }
 
-    auto subchannel = session.encode(LeadInSectors + session.leadOut.end + 1);
+    _subchannel = session.encode(_sectors);
     if(auto overlay = nall::file::read({Location::notsuffix(cueLocation), ".sub"})) {
-      auto target = subchannel.data() + 96 * (LeadInSectors + Track1Pregap);
-      auto length = (s64)subchannel.size() - 96 * (LeadInSectors + Track1Pregap);
+      auto target = _subchannel.data() + 96 * (LeadInSectors + Track1Pregap);
+      auto length = (s64)_subchannel.size() - 96 * (LeadInSectors + Track1Pregap);
       memory::copy(target, length, overlay.data(), overlay.size());
     }
 
-    for(u64 sector : range(size() / 2448)) {
-      auto source = subchannel.data() + sector * 96;
-      auto target = _image.data() + sector * 2448 + 2352;
-      memory::copy(target, source, 96);
+    for(auto& location : _locations) {
+      //missing track files read back as zeroes
+      _files.append(file_map{location, file_map::mode::read});
+    }
+
+    if(lazy) {
+      _slots.resize(CacheBlocks);
+      _cache.resize(CacheBlocks * BlockSize);
+      _blockSlots.resize((_size + BlockSize - 1) / BlockSize, ~0u);
+      return true;
     }
 
+    //sectors are independent once the TOC is known: blocks of them are synthesized across threads,
+    //straight from the track files mapped above
+    _image.resize(_size);
+    parallel::run((_sectors + BlockSectors - 1) / BlockSectors, [&](u32 block) {
+      u32 first = block * BlockSectors;
+      u32 last = min(first + BlockSectors, _sectors);
+      for(u32 sector : range(first, last)) synthesize(sector, _image.data() + 2448ull * sector);
+    });
+
+    //the eager image has no further use for the backing metadata
+    _subchannel.reset();
+    _extents.reset();
+    _locations.reset();
+    _files.reset();
     return true;
   }
 
+  //returns the extent containing lba, if any
+  auto extent(s32 lba) const -> const Extent* {
+    u32 lo = 0, hi = _extents.size();
+    while(lo < hi) {
+      u32 mid = (lo + hi) / 2;
+      if(_extents[mid].lba <= lba) lo = mid + 1;
+      else hi = mid;
+    }
+    if(!lo) return nullptr;
+    auto& extent = _extents[lo - 1];
+    if(lba >= extent.lba + (s32)extent.sectors) return nullptr;
+    return &extent;
+  }
+
+  //points the read window of the lazy image at the memory holding offset
+  auto window(u64 offset) -> void {
+    u32 sector = offset / 2448;
+    u64 sectorOffset = sector * 2448ull;
+
+    if(auto extent = this->extent((s32)sector - LeadInSectors); extent && extent->sectorSize == 2352) {
+      auto& fp = _files[extent->file];
+      u64 source = extent->offset + 2352ull * ((s32)sector - LeadInSectors - extent->lba);
+      if(offset - sectorOffset < 2352 && source + 2352 <= fp.size()) {
+        _window = fp.data() + source;
+        _windowOffset = sectorOffset;
+        _windowLength = 2352;
+        return;
+      }
+      if(offset - sectorOffset >= 2352) {
+        _window = _subchannel.data() + sector * 96;
+        _windowOffset = sectorOffset + 2352;
+        _windowLength = 96;
+        return;
+      }
+    }
+
+    _windowOffset = offset - offset % BlockSize;
+    _windowLength = BlockSize;
+    _window = materialize(offset / BlockSize);
+  }
+
+  //builds one complete 2448-byte sector from its backing track file
+  //only reads shared state, so that the eager image can build many sectors at once
+  auto synthesize(u32 sector, u8* target) const -> void {
+    s32 lba = (s32)sector - LeadInSectors;
+    array_view<u8> subchannel{_subchannel.data() + sector * 96, 96};
+
+    if(auto extent = this->extent(lba)) {
+      auto& fp = _files[extent->file];
+      u64 offset = extent->offset + (u64)extent->sectorSize * (lba - extent->lba);
+      u64 length = offset < fp.size() ? min((u64)extent->sectorSize, fp.size() - offset) : 0;
+      if(extent->sectorSize == 2048) {
+        CD::Sector::build(1, lba, {fp.data() + offset, length}, {target, 2448}, subchannel);
+        return;
+      }
+      if(length) memory::copy(target, fp.data() + offset, length);
+      memory::fill(target + length, 2352 - length);
+    } else {
+      memory::fill(target, 2352);
+    }
+
+    memory::copy(target + 2352, subchannel.data(), 96);
+  }
+
+  //returns the cached contents of the requested block, synthesizing it if necessary
+  auto materialize(u32 block) -> u8* {
+    u32 slot = _blockSlots[block];
+    if(slot == ~0u) {
+      //claim an unused slot, or evict the least recently used block
+      slot = _slotsUsed < CacheBlocks ? _slotsUsed++ : _slotTail;
+      if(_slots[slot].block != ~0u) {
+        _blockSlots[_slots[slot].block] = ~0u;
+        unlink(slot);
+      }
+      _slots[slot].block = block;
+      _blockSlots[block] = slot;
+
+      auto target = _cache.data() + (u64)slot * BlockSize;
+      u32 first = block * BlockSectors;
+      u32 last = min(first + BlockSectors, _sectors);
+      for(u32 sector : range(first, last)) synthesize(sector, target + (sector - first) * 2448);
+    } else {
+      unlink(slot);
+    }
+
+    //move to the front of the list
+    _slots[slot].previous = ~0;
+    _slots[slot].next = _slotHead;
+    if(_slotHead != ~0u) _slots[_slotHead].previous = slot;
+    _slotHead = slot;
+    if(_slotTail == ~0u) _slotTail = slot;
+    return _cache.data() + (u64)slot * BlockSize;
+  }
+
+  auto unlink(u32 slot) -> void {
+    auto& entry = _slots[slot];
+    if(entry.previous != ~0u) _slots[entry.previous].next = entry.next;
+    else _slotHead = entry.next;
+    if(entry.next != ~0u) _slots[entry.next].previous = entry.previous;
+    else _slotTail = entry.previous;
+    entry.previous = entry.next = ~0;
+  }
+
   vector<u8> _image;
+  u64 _size = 0;
   u64 _offset = 0;
+  u32 _sectors = 0;
+
+  //lazy image state
+  vector<Extent> _extents;
+  vector<string> _locations;
+  vector<file_map> _files;
+  vector<u8> _subchannel;
+  vector<u8> _cache;
+  vector<Slot> _slots;
+  vector<u32> _blockSlots;
+  u32 _slotsUsed = 0;
+  u32 _slotHead = ~0;
+  u32 _slotTail = ~0;
+  const u8* _window = nullptr;
+  u64 _windowOffset = 0;
+  u64 _windowLength = 0;
 
   static constexpr s32 LeadInSectors  = 7500;
   static constexpr s32 Track1Pregap   =  150;
   static constexpr s32 LeadOutSectors = 6750;
+
+  static constexpr u32 BlockSectors = 16;
+  static constexpr u32 BlockSize    = 2448 * BlockSectors;
+  static constexpr u32 CacheBlocks  = 512;  //~19 MiB
 };
 
 }
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <nall/file.hpp>
+#include <nall/file-map.hpp>
 
 namespace nall::vfs {
 
@@ -36,6 +37,23 @@ struct disk : file {
     _data[_offset++] = data;
   }
 
+  auto read(array_span<u8> span) -> void override {
+    u64 length = _offset < _size ? min(span.size(), _size - _offset) : 0;
+    if(length) memcpy(span.data(), _data + _offset, length);
+    memset(span.data() + length, 0x00, span.size() - length);
+    _offset += length;
+  }
+
+  auto write(array_view<u8> view) -> void override {
+    u64 length = _offset < _size ? min(view.size(), _size - _offset) : 0;
+    if(length) memcpy(_data + _offset, view.data(), length);
+    _offset += length;
+  }
+
+  auto advise(u32 hint) -> bool override {
+    return _fp.advise(hint);
+  }
+
 private:
   disk() = default;
   disk(const disk&) = delete;
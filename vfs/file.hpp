@@ -14,24 +14,32 @@ struct file : node {
   virtual auto read() -> u8 = 0;
   virtual auto write(u8 data) -> void = 0;
   virtual auto flush() -> void {}
+  virtual auto advise(u32 hint) -> bool { return false; }
 
   auto end() const -> bool {
     return offset() >= size();
   }
 
-  auto read(array_span<u8> span) -> void {
+  //implementations holding contiguous data should override these with block copies
+  virtual auto read(array_span<u8> span) -> void {
     while(span) *span++ = read();
   }
 
   auto readl(u32 bytes) -> u64 {
+    bytes = min(bytes, 8u);
+    u8 buffer[8];
+    read({buffer, bytes});
     u64 data = 0;
-    for(auto n : range(bytes)) data |= (u64)read() << n * 8;
+    for(auto n : range(bytes)) data |= (u64)buffer[n] << n * 8;
     return data;
   }
 
   auto readm(u32 bytes) -> u64 {
+    bytes = min(bytes, 8u);
+    u8 buffer[8];
+    read({buffer, bytes});
     u64 data = 0;
-    for(auto n : range(bytes)) data = data << 8 | read();
+    for(auto n : range(bytes)) data = data << 8 | buffer[n];
     return data;
   }
 
@@ -43,21 +51,35 @@ struct file : node {
     return s;
   }
 
-  auto write(array_view<u8> view) -> void {
+  virtual auto write(array_view<u8> view) -> void {
     while(view) write(*view++);
   }
 
   auto writel(u64 data, u32 bytes) -> void {
-    for(auto n : range(bytes)) write(data), data >>= 8;
+    bytes = min(bytes, 8u);
+    u8 buffer[8];
+    for(auto n : range(bytes)) buffer[n] = data, data >>= 8;
+    write({buffer, bytes});
   }
 
   auto writem(u64 data, u32 bytes) -> void {
-    for(auto n : reverse(range(bytes))) write(data >> n * 8);
+    bytes = min(bytes, 8u);
+    u8 buffer[8];
+    for(auto n : range(bytes)) buffer[n] = data >> (bytes - 1 - n) * 8;
+    write({buffer, bytes});
   }
 
   auto writes(const string& s) -> void {
     write(s);
   }
+
+protected:
+  //heap buffers only accept hints that cannot discard their contents:
+  //dontneed would zero-fill private pages, and the other hints are meaningless without a backing file
+  static auto adviseHeap(const void* data, u64 size, u32 hint) -> bool {
+    if(hint != advice::willneed && hint != advice::hugepage) return false;
+    return file_map::advise(data, size, hint);
+  }
 };
 
 }
@@ -8,6 +8,9 @@ enum class index : u32 { absolute, relative };
 static constexpr auto absolute = index::absolute;
 static constexpr auto relative = index::relative;
 
+//access pattern hints, passed to file::advise()
+using advice = file_map::advice;
+
 struct node {
   virtual ~node() = default;
 
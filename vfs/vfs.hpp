@@ -1,5 +1,6 @@
 #pragma once
 
+#include <nall/file-map.hpp>
 #include <nall/iterator.hpp>
 #include <nall/range.hpp>
 #include <nall/set.hpp>